@@ -0,0 +1,120 @@
+// Host benchmark for chunk_decoder, not part of the Flipper app (excluded in application.fam).
+//   cc -O2 -I.. -o chunk_decoder_bench chunk_decoder_bench.c ../chunk_decoder.c && ./chunk_decoder_bench
+// Decodes a whole canvas worth of [MAP/CHUNK] frames with the table decoder and with the
+// strtoul-per-byte loop it replaced, and checks both agree.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chunk_decoder.h"
+
+#define PAINTED_BYTES_SIZE 31250
+#define CHUNK_BYTES        1000 // what fits in the server's 2048 character frames
+#define ROUNDS             200
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// The previous listener code
+static void decode_strtoul(const char* message, uint8_t* canvas) {
+    const char* first_colon = strchr(message + 11, ':');
+    const char* bracket_pos = strchr(message, ']');
+    int start_pos = atoi(first_colon + 1);
+    const char* data = bracket_pos + 1;
+    size_t num_bytes = strlen(data) / 2;
+    if(start_pos + num_bytes > PAINTED_BYTES_SIZE) num_bytes = PAINTED_BYTES_SIZE - start_pos;
+    for(size_t i = 0; i < num_bytes; ++i) {
+        char byte_str[3] = {data[i * 2], data[i * 2 + 1], '\0'};
+        canvas[start_pos + i] = (uint8_t)strtoul(byte_str, NULL, 16);
+    }
+}
+
+static int check(const char* message, ChunkResult expected) {
+    uint8_t out[16];
+    memset(out, 0x5A, sizeof(out));
+    ChunkInfo info;
+    ChunkResult result = chunk_decode(message, strlen(message), out, sizeof(out), 100, &info);
+    if(result != expected) {
+        printf("FAIL %s: got %d, expected %d\n", message, result, expected);
+        return 1;
+    }
+    // out is only written for a valid frame
+    for(size_t i = 0; result != ChunkOk && i < sizeof(out); i++) {
+        if(out[i] != 0x5A) {
+            printf("FAIL %s: out written before the error\n", message);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    static uint8_t truth[PAINTED_BYTES_SIZE], canvas[PAINTED_BYTES_SIZE], buffer[CHUNK_BYTES];
+    static const char HEX[] = "0123456789ABCDEF";
+    srand(1);
+    for(size_t i = 0; i < PAINTED_BYTES_SIZE; i++) truth[i] = (uint8_t)rand();
+
+    size_t chunk_count = (PAINTED_BYTES_SIZE + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    char** chunks = malloc(chunk_count * sizeof(char*));
+    size_t* lengths = malloc(chunk_count * sizeof(size_t));
+    for(size_t c = 0; c < chunk_count; c++) {
+        size_t start = c * CHUNK_BYTES;
+        size_t size = start + CHUNK_BYTES > PAINTED_BYTES_SIZE ? PAINTED_BYTES_SIZE - start : CHUNK_BYTES;
+        chunks[c] = malloc(32 + size * 2 + 1);
+        int header = sprintf(chunks[c], "[MAP/CHUNK:%zu:%zu]", c, start);
+        for(size_t i = 0; i < size; i++) {
+            chunks[c][header + 2 * i] = HEX[truth[start + i] >> 4];
+            chunks[c][header + 2 * i + 1] = HEX[truth[start + i] & 0x0F];
+        }
+        chunks[c][header + size * 2] = '\0';
+        lengths[c] = header + size * 2;
+    }
+
+    double begin = now_ms();
+    for(int round = 0; round < ROUNDS; round++) {
+        for(size_t c = 0; c < chunk_count; c++) decode_strtoul(chunks[c], canvas);
+    }
+    double strtoul_ms = (now_ms() - begin) / ROUNDS;
+    int failures = memcmp(canvas, truth, PAINTED_BYTES_SIZE) != 0;
+
+    memset(canvas, 0, PAINTED_BYTES_SIZE);
+    begin = now_ms();
+    for(int round = 0; round < ROUNDS; round++) {
+        for(size_t c = 0; c < chunk_count; c++) {
+            ChunkInfo info;
+            if(chunk_decode(chunks[c], lengths[c], buffer, sizeof(buffer), PAINTED_BYTES_SIZE, &info) != ChunkOk) {
+                failures++;
+                continue;
+            }
+            memcpy(canvas + info.start, buffer, info.size);
+        }
+    }
+    double table_ms = (now_ms() - begin) / ROUNDS;
+    failures += memcmp(canvas, truth, PAINTED_BYTES_SIZE) != 0;
+
+    failures += check("[MAP/CHUNK:0:0]0a0B", ChunkOk);
+    failures += check("[MAP/CHUNK:0:98]AABBCC", ChunkOk); // clipped to the canvas
+    failures += check("[PIXEL]x:1,y:1,c:1", ChunkNotChunk);
+    failures += check("[MAP/CHUNK:0]AA", ChunkBadHeader);
+    failures += check("[MAP/CHUNK:0:x]AA", ChunkBadHeader);
+    failures += check("[MAP/CHUNK:0:0", ChunkBadHeader);
+    failures += check("[MAP/CHUNK:0:99999999999]AA", ChunkBadHeader);
+    failures += check("[MAP/CHUNK:0:100]AA", ChunkOutOfBounds);
+    failures += check("[MAP/CHUNK:0:0]000000000000000000000000000000000000", ChunkOutOfBounds);
+    failures += check("[MAP/CHUNK:0:0]AAB", ChunkBadHex);
+    failures += check("[MAP/CHUNK:0:0]AG", ChunkBadHex);
+    failures += check("[MAP/CHUNK:0:0]AABBZZ", ChunkBadHex);
+
+    printf("full canvas, %zu chunks: strtoul %.3f ms, table %.3f ms (%.1fx)\n", chunk_count, strtoul_ms, table_ms,
+           strtoul_ms / table_ms);
+    for(size_t c = 0; c < chunk_count; c++) free(chunks[c]);
+    free(chunks);
+    free(lengths);
+    if(failures) printf("%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+// Host benchmark for flipper_http's line_framer, not part of the Flipper app (excluded in application.fam).
+//   cc -O2 -I../flipper_http -o line_framer_bench line_framer_bench.c ../flipper_http/line_framer.c && ./line_framer_bench
+// Frames a map sync worth of lines fed in random block sizes, checks the lines match the byte at
+// a time loop it replaced, and times both.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "line_framer.h"
+
+#define LINE_CAPACITY 3000 // RX_LINE_BUFFER_SIZE
+#define STREAM_SIZE   (40 * 2048)
+#define ROUNDS        100
+
+typedef struct {
+    unsigned long lines;
+    unsigned long checksum;
+} Collected;
+
+static void collect(char* line, size_t length, void* context) {
+    Collected* collected = context;
+    if(strlen(line) != length) printf("FAIL length mismatch\n");
+    collected->lines++;
+    for(size_t i = 0; i < length; i++) collected->checksum = collected->checksum * 31 + (unsigned char)line[i];
+    collected->checksum = collected->checksum * 31 + 7; // line boundary
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// The previous worker loop
+static void frame_bytewise(const char* stream, size_t size, char* buffer, Collected* collected) {
+    size_t pos = 0;
+    for(size_t i = 0; i < size; i++) {
+        char c = stream[i];
+        if(c == '\n' || pos >= LINE_CAPACITY - 1) {
+            buffer[pos] = '\0';
+            collect(buffer, pos, collected);
+            pos = 0;
+        } else {
+            buffer[pos++] = c;
+        }
+    }
+}
+
+static int check_trim(const char* text, const char* expected) {
+    size_t length = strlen(text);
+    const char* trimmed = line_trim(text, &length);
+    if(length != strlen(expected) || memcmp(trimmed, expected, length) != 0) {
+        printf("FAIL trim \"%s\"\n", text);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    static char stream[STREAM_SIZE], buffer[LINE_CAPACITY];
+    srand(1);
+    // hex chunk lines like a map sync, plus a few short frames, all shorter than the buffer
+    size_t size = 0;
+    while(size < STREAM_SIZE - 2100) {
+        size_t length = rand() % 4 == 0 ? 10 + rand() % 30 : 2000 + rand() % 40;
+        for(size_t i = 0; i < length; i++) stream[size++] = "0123456789ABCDEF"[rand() % 16];
+        if(rand() % 3 == 0) stream[size++] = '\r';
+        stream[size++] = '\n';
+    }
+
+    int failures = 0;
+    Collected reference = {0}, framed = {0};
+    double begin = now_ms();
+    for(int round = 0; round < ROUNDS; round++) {
+        reference = (Collected){0};
+        frame_bytewise(stream, size, buffer, &reference);
+    }
+    double bytewise_ms = (now_ms() - begin) / ROUNDS;
+
+    begin = now_ms();
+    for(int round = 0; round < ROUNDS; round++) {
+        framed = (Collected){0};
+        LineFramer framer;
+        line_framer_init(&framer, buffer, LINE_CAPACITY);
+        for(size_t offset = 0; offset < size;) {
+            size_t block = 1 + rand() % 256; // RX_BLOCK_SIZE
+            if(block > size - offset) block = size - offset;
+            line_framer_feed(&framer, stream + offset, block, collect, &framed);
+            offset += block;
+        }
+    }
+    double framed_ms = (now_ms() - begin) / ROUNDS;
+    if(framed.lines != reference.lines || framed.checksum != reference.checksum) {
+        printf("FAIL framed lines differ from the byte at a time loop\n");
+        failures++;
+    }
+
+    // a line that doesn't fit comes out in pieces of capacity - 1
+    Collected pieces = {0};
+    char small[8];
+    LineFramer framer;
+    line_framer_init(&framer, small, sizeof(small));
+    line_framer_feed(&framer, "0123456789ABCDEF\nxy\n", 20, collect, &pieces);
+    failures += pieces.lines != 4; // 7 + 7 + 2 + "xy"
+    Collected exact = {0};
+    line_framer_feed(&framer, "0123456\n", 8, collect, &exact);
+    failures += exact.lines != 1; // exactly capacity - 1, no empty line after it
+
+    failures += check_trim("  [PIXEL]x:1 \r", "[PIXEL]x:1");
+    failures += check_trim("[MAP/END]", "[MAP/END]");
+    failures += check_trim(" \t\r", "");
+    failures += check_trim("", "");
+
+    printf("%lu lines, %zu bytes: byte at a time %.3f ms, blocks %.3f ms (%.1fx)\n", framed.lines, size, bytewise_ms,
+           framed_ms, bytewise_ms / framed_ms);
+    if(failures) printf("%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+#include "chunk_decoder.h"
+
+#include <string.h>
+
+#define CHUNK_PREFIX        "[MAP/CHUNK:"
+#define CHUNK_PREFIX_LENGTH (sizeof(CHUNK_PREFIX) - 1)
+
+// Digit value + 1, 0 marks a character that is not a hex digit
+static const uint8_t HEX_VALUES[256] = {
+    ['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,  ['5'] = 6,  ['6'] = 7,  ['7'] = 8,
+    ['8'] = 9,  ['9'] = 10, ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+};
+
+bool chunk_hex_decode(const char* hex, uint8_t* out, size_t count) {
+    const uint8_t* digits = (const uint8_t*)hex;
+    // check every digit first, so a bad one leaves out untouched
+    for(size_t i = 0; i < 2 * count; i++) {
+        if(!HEX_VALUES[digits[i]]) return false;
+    }
+    for(size_t i = 0; i < count; i++) {
+        out[i] = (uint8_t)(((HEX_VALUES[digits[2 * i]] - 1) << 4) | (HEX_VALUES[digits[2 * i + 1]] - 1));
+    }
+    return true;
+}
+
+// Decimal number ending at the first non-digit, false when there are no digits or it overflows
+static bool parse_number(const char** text, const char* end, uint32_t* value) {
+    const char* p = *text;
+    uint32_t result = 0;
+    while(p < end && *p >= '0' && *p <= '9') {
+        if(result > (UINT32_MAX - 9) / 10) return false;
+        result = result * 10 + (uint32_t)(*p - '0');
+        p++;
+    }
+    if(p == *text) return false;
+    *value = result;
+    *text = p;
+    return true;
+}
+
+ChunkResult chunk_decode(
+    const char* message,
+    size_t length,
+    uint8_t* out,
+    size_t out_capacity,
+    size_t canvas_size,
+    ChunkInfo* info) {
+    if(length < CHUNK_PREFIX_LENGTH || memcmp(message, CHUNK_PREFIX, CHUNK_PREFIX_LENGTH) != 0) {
+        return ChunkNotChunk;
+    }
+    const char* end = message + length;
+    const char* text = message + CHUNK_PREFIX_LENGTH;
+    if(!parse_number(&text, end, &info->id) || text == end || *text++ != ':' ||
+       !parse_number(&text, end, &info->start) || text == end || *text++ != ']') {
+        return ChunkBadHeader;
+    }
+
+    size_t hex_length = (size_t)(end - text);
+    if(hex_length % 2 != 0) return ChunkBadHex;
+    if(info->start >= canvas_size) return ChunkOutOfBounds;
+    size_t size = hex_length / 2;
+    if(size > canvas_size - info->start) size = canvas_size - info->start;
+    if(size > out_capacity) return ChunkOutOfBounds;
+    if(!chunk_hex_decode(text, out, size)) return ChunkBadHex;
+    info->size = size;
+    return ChunkOk;
+}
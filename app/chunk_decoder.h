@@ -0,0 +1,35 @@
+#pragma once
+
+// Decoding of the server's "[MAP/CHUNK:id:start]HEX" canvas frames.
+// Plain C without Furi, so it builds and benchmarks on a host too (see bench/).
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    ChunkOk,
+    ChunkNotChunk, // doesn't start with [MAP/CHUNK:
+    ChunkBadHeader, // id or start missing, or no closing ']'
+    ChunkOutOfBounds, // start past the canvas, or more bytes than the output holds
+    ChunkBadHex, // odd length or a character that is not a hex digit
+} ChunkResult;
+
+typedef struct {
+    uint32_t id;
+    uint32_t start; // canvas byte offset of the first decoded byte
+    size_t size; // decoded bytes, already clipped to the canvas
+} ChunkInfo;
+
+// Decode count bytes from 2 * count hex digits, false without writing out on anything that is not a hex digit
+bool chunk_hex_decode(const char* hex, uint8_t* out, size_t count);
+
+// Decode a chunk frame of length characters into out, which holds out_capacity bytes.
+// Bytes past canvas_size are dropped, out is only written when the whole frame is valid.
+ChunkResult chunk_decode(
+    const char* message,
+    size_t length,
+    uint8_t* out,
+    size_t out_capacity,
+    size_t canvas_size,
+    ChunkInfo* info);
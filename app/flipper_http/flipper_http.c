@@ -20,7 +20,7 @@ static int32_t flipper_http_worker(void* context) {
         FURI_LOG_E(HTTP_TAG, "Failed to get context.");
         return -1;
     }
-    size_t rx_line_pos = 0;
+    line_framer_init(&fhttp->rx_framer, fhttp->rx_line_buffer, RX_LINE_BUFFER_SIZE);
 
     while(1) {
         uint32_t events = furi_thread_flags_wait(
@@ -29,55 +29,50 @@ static int32_t flipper_http_worker(void* context) {
             break;
         }
         if(events & WorkerEvtRxDone) {
-            // Continuously read from the stream buffer until it's empty
-            while(!furi_stream_buffer_is_empty(fhttp->flipper_http_stream)) {
-                // Read one byte at a time
-                char c = 0;
-                size_t received = furi_stream_buffer_receive(fhttp->flipper_http_stream, &c, 1, 0);
-
+            // Read in blocks until the stream buffer is empty
+            while(1) {
+                size_t received = furi_stream_buffer_receive(
+                    fhttp->flipper_http_stream, fhttp->rx_block, RX_BLOCK_SIZE, 0);
                 if(received == 0) {
-                    // No more data to read
                     break;
                 }
 
                 fhttp->bytes_received += received;
 
-                // print amount of bytes received
-                // FURI_LOG_I(HTTP_TAG, "Bytes received: %d", fhttp->bytes_received);
-
-                // Append the received byte to the file if saving is enabled
+                // Append the received bytes to the file if saving is enabled
                 if(fhttp->save_bytes) {
-                    // Add byte to the buffer
-                    fhttp->file_buffer[fhttp->file_buffer_len++] = c;
-                    // Write to file if buffer is full
-                    if(fhttp->file_buffer_len >= FILE_BUFFER_SIZE) {
-                        if(!flipper_http_append_to_file(
-                               fhttp->file_buffer,
-                               fhttp->file_buffer_len,
-                               fhttp->just_started_bytes,
-                               fhttp->file_path)) {
-                            FURI_LOG_E(HTTP_TAG, "Failed to append data to file");
+                    const uint8_t* data = fhttp->rx_block;
+                    size_t remaining = received;
+                    while(remaining > 0) {
+                        size_t count = FILE_BUFFER_SIZE - fhttp->file_buffer_len;
+                        if(count > remaining) count = remaining;
+                        memcpy(fhttp->file_buffer + fhttp->file_buffer_len, data, count);
+                        fhttp->file_buffer_len += count;
+                        data += count;
+                        remaining -= count;
+                        // Write to file if buffer is full
+                        if(fhttp->file_buffer_len >= FILE_BUFFER_SIZE) {
+                            if(!flipper_http_append_to_file(
+                                   fhttp->file_buffer,
+                                   fhttp->file_buffer_len,
+                                   fhttp->just_started_bytes,
+                                   fhttp->file_path)) {
+                                FURI_LOG_E(HTTP_TAG, "Failed to append data to file");
+                            }
+                            fhttp->file_buffer_len = 0;
+                            fhttp->just_started_bytes = false;
                         }
-                        fhttp->file_buffer_len = 0;
-                        fhttp->just_started_bytes = false;
                     }
                 }
 
                 // Handle line buffering only if callback is set (text data)
                 if(fhttp->handle_rx_line_cb) {
-                    // Handle line buffering
-                    if(c == '\n' || rx_line_pos >= RX_LINE_BUFFER_SIZE - 1) {
-                        fhttp->rx_line_buffer[rx_line_pos] = '\0'; // Null-terminate the line
-
-                        // Invoke the callback with the complete line
-                        fhttp->handle_rx_line_cb(fhttp->rx_line_buffer, fhttp->callback_context);
-
-                        // Reset the line buffer position
-                        rx_line_pos = 0;
-                    } else {
-                        fhttp->rx_line_buffer[rx_line_pos++] =
-                            c; // Add character to the line buffer
-                    }
+                    line_framer_feed(
+                        &fhttp->rx_framer,
+                        (const char*)fhttp->rx_block,
+                        received,
+                        fhttp->handle_rx_line_cb,
+                        fhttp->callback_context);
                 }
             }
         }
@@ -105,9 +100,20 @@ static void _flipper_http_rx_callback(
         return;
     }
     if(event == FuriHalSerialRxEventData) {
-        uint8_t data = furi_hal_serial_async_rx(handle);
-        furi_stream_buffer_send(fhttp->flipper_http_stream, &data, 1, 0);
-        furi_thread_flags_set(fhttp->rx_thread_id, WorkerEvtRxDone);
+        // forward everything the UART holds in one send
+        uint8_t data[RX_ISR_BLOCK_SIZE];
+        size_t count = 0;
+        do {
+            data[count++] = furi_hal_serial_async_rx(handle);
+        } while(count < RX_ISR_BLOCK_SIZE && furi_hal_serial_async_rx_available(handle));
+
+        // The worker reads until the buffer is empty, so it only needs waking when it may have
+        // found it empty. Thread flags latch, a wake between its last read and its wait isn't lost.
+        bool was_empty = furi_stream_buffer_is_empty(fhttp->flipper_http_stream);
+        furi_stream_buffer_send(fhttp->flipper_http_stream, data, count, 0);
+        if(was_empty) {
+            furi_thread_flags_set(fhttp->rx_thread_id, WorkerEvtRxDone);
+        }
     }
 }
 
@@ -133,7 +139,7 @@ static void get_timeout_timer_callback(void* context) {
     fhttp->state = ISSUE;
 }
 
-static void flipper_http_rx_callback(const char* line, void* context); // forward declaration
+static void flipper_http_rx_callback(char* line, size_t length, void* context); // forward declaration
 
 // UART initialization function
 /**
@@ -307,6 +313,11 @@ void flipper_http_free(FlipperHTTP* fhttp) {
         fhttp->last_response = NULL;
     }
 
+    if(fhttp->line_queue) {
+        furi_stream_buffer_free(fhttp->line_queue);
+        fhttp->line_queue = NULL;
+    }
+
     // Free the FlipperHTTP context
     free(fhttp);
     fhttp = NULL;
@@ -314,6 +325,79 @@ void flipper_http_free(FlipperHTTP* fhttp) {
     FURI_LOG_I("FlipperHTTP", "UART deinitialized successfully.");
 }
 
+/**
+ * @brief      Queue every received line, not just the last one in last_response.
+ * @return     true if the queue was allocated or already enabled, false otherwise.
+ * @param fhttp The FlipperHTTP context
+ * @note       Enable it before the lines you want arrive, and keep reading them with
+ *             flipper_http_receive_line, the RX thread waits when the queue is full.
+ */
+bool flipper_http_line_queue_enable(FlipperHTTP* fhttp) {
+    if(!fhttp) {
+        FURI_LOG_E(HTTP_TAG, "Failed to get context.");
+        return false;
+    }
+    if(!fhttp->line_queue) {
+        fhttp->line_queue = furi_stream_buffer_alloc(LINE_QUEUE_SIZE, 1);
+    }
+    return fhttp->line_queue != NULL;
+}
+
+/**
+ * @brief      Add a line to the line queue as its 16-bit length followed by its characters.
+ * @return     void
+ * @param fhttp The FlipperHTTP context
+ * @param      line    The line, not null-terminated.
+ * @param      length  The length of the line.
+ * @note       Called from the RX thread only, the single writer of the queue. A record is written with
+ *             one send once it fits whole, so the reader never sees a length without its line.
+ */
+static void flipper_http_queue_line(FlipperHTTP* fhttp, const char* line, size_t length) {
+    if(length >= RX_LINE_BUFFER_SIZE) length = RX_LINE_BUFFER_SIZE - 1; // the reader's buffer holds no more
+    uint16_t header = (uint16_t)length;
+    memcpy(fhttp->line_record, &header, sizeof(header));
+    memcpy(fhttp->line_record + sizeof(header), line, length);
+    uint32_t waited = 0;
+    while(furi_stream_buffer_spaces_available(fhttp->line_queue) < sizeof(header) + length) {
+        if(waited++ >= LINE_QUEUE_TIMEOUT) {
+            fhttp->lines_dropped++;
+            FURI_LOG_E(HTTP_TAG, "Line queue full, dropped %u lines so far.", (unsigned)fhttp->lines_dropped);
+            return;
+        }
+        furi_delay_ms(1);
+    }
+    furi_stream_buffer_send(fhttp->line_queue, fhttp->line_record, sizeof(header) + length, 0);
+}
+
+/**
+ * @brief      Take the oldest line from the line queue.
+ * @return     The length of the line, 0 when none arrived within the timeout.
+ * @param fhttp The FlipperHTTP context
+ * @param      line     Buffer of at least RX_LINE_BUFFER_SIZE bytes, the line is null-terminated.
+ * @param      timeout  Ticks to wait for a line.
+ */
+size_t flipper_http_receive_line(FlipperHTTP* fhttp, char* line, uint32_t timeout) {
+    if(!fhttp || !fhttp->line_queue || !line) {
+        FURI_LOG_E(HTTP_TAG, "Invalid arguments provided to flipper_http_receive_line.");
+        return 0;
+    }
+    uint16_t length = 0;
+    if(furi_stream_buffer_receive(fhttp->line_queue, &length, sizeof(length), timeout) != sizeof(length)) {
+        return 0;
+    }
+    // the record was sent in one piece, so the line is already there. Anything else means the
+    // queue is out of step, and every length after this one would be read from line data.
+    if(length >= RX_LINE_BUFFER_SIZE ||
+       furi_stream_buffer_receive(fhttp->line_queue, line, length, 0) != length) {
+        FURI_LOG_E(HTTP_TAG, "Line queue out of step, dropping its contents.");
+        furi_stream_buffer_reset(fhttp->line_queue);
+        fhttp->lines_dropped++;
+        return 0;
+    }
+    line[length] = '\0';
+    return length;
+}
+
 /**
  * @brief      Append received data to a file.
  * @return     true if the data was appended successfully, false otherwise.
@@ -1045,38 +1129,14 @@ static void set_header(FlipperHTTP* fhttp) {
     furi_string_free(furi_string);
 }
 
-// Function to trim leading and trailing spaces and newlines from a constant string
-static char* trim(const char* str) {
-    const char* end;
-    char* trimmed_str;
-    size_t len;
-
-    // Trim leading space
-    while(isspace((unsigned char)*str))
-        str++;
-
-    // All spaces?
-    if(*str == 0) return strdup(""); // Return an empty string if all spaces
-
-    // Trim trailing space
-    end = str + strlen(str) - 1;
-    while(end > str && isspace((unsigned char)*end))
-        end--;
-
-    // Set length for the trimmed string
-    len = end - str + 1;
-
-    // Allocate space for the trimmed string and null terminator
-    trimmed_str = (char*)malloc(len + 1);
-    if(trimmed_str == NULL) {
-        return NULL; // Handle memory allocation failure
+// Whether the trimmed line is one of the [GET/END], [POST/END], [PUT/END] or [DELETE/END] markers
+static bool is_request_end(const char* line, size_t length) {
+    static const char* const markers[] = {"[GET/END]", "[POST/END]", "[PUT/END]", "[DELETE/END]"};
+    if(length < 9 || line[0] != '[' || line[length - 1] != ']') return false;
+    for(size_t i = 0; i < sizeof(markers) / sizeof(markers[0]); i++) {
+        if(strlen(markers[i]) == length && memcmp(markers[i], line, length) == 0) return true;
     }
-
-    // Copy the trimmed part of the string into trimmed_str
-    strncpy(trimmed_str, str, len);
-    trimmed_str[len] = '\0'; // Null terminate the string
-
-    return trimmed_str;
+    return false;
 }
 
 /**
@@ -1086,7 +1146,7 @@ static char* trim(const char* str) {
  * @param      context  The FlipperHTTP context.
  * @note       The received data will be handled asynchronously via the callback and handles the state of the UART.
  */
-static void flipper_http_rx_callback(const char* line, void* context) {
+static void flipper_http_rx_callback(char* line, size_t length, void* context) {
     FlipperHTTP* fhttp = (FlipperHTTP*)context;
     if(!fhttp) {
         FURI_LOG_E(HTTP_TAG, "Failed to get context.");
@@ -1097,25 +1157,25 @@ static void flipper_http_rx_callback(const char* line, void* context) {
         return;
     }
 
-    // Trim the received line to check if it's empty
-    char* trimmed_line = trim(line);
-    if(trimmed_line != NULL && trimmed_line[0] != '\0') {
-        // if the line is not [GET/END] or [POST/END] or [PUT/END] or [DELETE/END]
-        if(strstr(trimmed_line, "[GET/END]") == NULL &&
-           strstr(trimmed_line, "[POST/END]") == NULL &&
-           strstr(trimmed_line, "[PUT/END]") == NULL &&
-           strstr(trimmed_line, "[DELETE/END]") == NULL) {
-            strncpy(fhttp->last_response, trimmed_line, RX_BUF_SIZE);
+    // Trim the received line to check if it's empty, without copying it
+    size_t trimmed_length = length;
+    const char* trimmed_line = line_trim(line, &trimmed_length);
+    if(trimmed_length > 0 && !is_request_end(trimmed_line, trimmed_length)) {
+        size_t copy_length = trimmed_length < RX_BUF_SIZE - 1 ? trimmed_length : RX_BUF_SIZE - 1;
+        memcpy(fhttp->last_response, trimmed_line, copy_length);
+        fhttp->last_response[copy_length] = '\0';
+        if(fhttp->line_queue) {
+            flipper_http_queue_line(fhttp, trimmed_line, trimmed_length);
         }
     }
-    free(trimmed_line); // Free the allocated memory for trimmed_line
 
     if(fhttp->state != INACTIVE && fhttp->state != ISSUE) {
         fhttp->state = RECEIVING;
     }
 
-    // Uncomment below line to log the data received over UART
+#if FLIPPER_HTTP_LOG_LINES
     FURI_LOG_I(HTTP_TAG, "Received UART line: %s", line);
+#endif
 
     // Check if we've started receiving data from a GET request
     if(fhttp->started_receiving && (fhttp->method == GET || fhttp->method == BYTES)) {
@@ -1168,7 +1228,7 @@ static void flipper_http_rx_callback(const char* line, void* context) {
         // Append the new line to the existing data
         if(fhttp->save_received_data &&
            !flipper_http_append_to_file(
-               line, strlen(line), !fhttp->just_started, fhttp->file_path)) {
+               line, length, !fhttp->just_started, fhttp->file_path)) {
             FURI_LOG_E(HTTP_TAG, "Failed to append data to file.");
             fhttp->started_receiving = false;
             fhttp->just_started = false;
@@ -1233,7 +1293,7 @@ static void flipper_http_rx_callback(const char* line, void* context) {
         // Append the new line to the existing data
         if(fhttp->save_received_data &&
            !flipper_http_append_to_file(
-               line, strlen(line), !fhttp->just_started, fhttp->file_path)) {
+               line, length, !fhttp->just_started, fhttp->file_path)) {
             FURI_LOG_E(HTTP_TAG, "Failed to append data to file.");
             fhttp->started_receiving = false;
             fhttp->just_started = false;
@@ -1268,7 +1328,7 @@ static void flipper_http_rx_callback(const char* line, void* context) {
         // Append the new line to the existing data
         if(fhttp->save_received_data &&
            !flipper_http_append_to_file(
-               line, strlen(line), !fhttp->just_started, fhttp->file_path)) {
+               line, length, !fhttp->just_started, fhttp->file_path)) {
             FURI_LOG_E(HTTP_TAG, "Failed to append data to file.");
             fhttp->started_receiving = false;
             fhttp->just_started = false;
@@ -1303,7 +1363,7 @@ static void flipper_http_rx_callback(const char* line, void* context) {
         // Append the new line to the existing data
         if(fhttp->save_received_data &&
            !flipper_http_append_to_file(
-               line, strlen(line), !fhttp->just_started, fhttp->file_path)) {
+               line, length, !fhttp->just_started, fhttp->file_path)) {
             FURI_LOG_E(HTTP_TAG, "Failed to append data to file.");
             fhttp->started_receiving = false;
             fhttp->just_started = false;
@@ -14,6 +14,8 @@
 #include <furi_hal_serial.h>
 #include <storage/storage.h>
 
+#include "line_framer.h"
+
 #define HTTP_TAG               "FlipperHTTP" // change this to your app name
 #define http_tag               "flipper_http" // change this to your app id
 #define UART_CH                (FuriHalSerialIdUsart) // UART channel
@@ -23,9 +25,17 @@
 #define RX_LINE_BUFFER_SIZE    3000 // UART RX line buffer size (increase for large responses)
 #define MAX_FILE_SHOW          12000 // Maximum data from file to show
 #define FILE_BUFFER_SIZE       512 // File buffer size
+#define LINE_QUEUE_SIZE        (2 * RX_LINE_BUFFER_SIZE) // Bytes of received lines waiting in the line queue
+#define LINE_QUEUE_TIMEOUT     100 // Milliseconds the RX thread waits for room in the line queue
+#define RX_BLOCK_SIZE          256 // Bytes the RX thread takes from the stream buffer at once
+#define RX_ISR_BLOCK_SIZE      16 // Bytes the UART interrupt forwards at once
+
+#ifndef FLIPPER_HTTP_LOG_LINES
+#define FLIPPER_HTTP_LOG_LINES 0 // Log every received line, slow with 2 KB lines
+#endif
 
-// Forward declaration for callback
-typedef void (*FlipperHTTP_Callback)(const char* line, void* context);
+// Forward declaration for callback, called with each received line (see LineFramerCallback)
+typedef void (*FlipperHTTP_Callback)(char* line, size_t length, void* context);
 
 // State variable to track the UART state
 typedef enum {
@@ -76,6 +86,9 @@ typedef struct {
     HTTPState state; // State of the UART
     HTTPMethod method; // HTTP method
     char* last_response; // variable to store the last received data from the UART
+    FuriStreamBuffer* line_queue; // every received line in order, NULL unless enabled
+    size_t lines_dropped; // lines that found the line queue full, the reader repairs what they changed
+    uint8_t line_record[2 + RX_LINE_BUFFER_SIZE]; // length and line, sent to the line queue in one piece
     char file_path[256]; // Path to save the received data
     FuriTimer* get_timeout_timer; // Timer for HTTP request timeout
     bool started_receiving; // Indicates if a request has started
@@ -86,6 +99,8 @@ typedef struct {
     bool just_started_bytes; // Indicates if bytes data reception has just started
     size_t bytes_received; // Number of bytes received
     char rx_line_buffer[RX_LINE_BUFFER_SIZE]; // Buffer for received lines
+    LineFramer rx_framer; // Splits received blocks into lines in rx_line_buffer
+    uint8_t rx_block[RX_BLOCK_SIZE]; // Block read from the stream buffer
     uint8_t file_buffer[FILE_BUFFER_SIZE]; // Buffer for file data
     size_t file_buffer_len; // Length of the file buffer
     size_t content_length; // Length of the content received
@@ -107,6 +122,24 @@ FlipperHTTP* flipper_http_alloc();
  */
 void flipper_http_free(FlipperHTTP* fhttp);
 
+/**
+ * @brief      Queue every received line, not just the last one in last_response.
+ * @return     true if the queue was allocated or already enabled, false otherwise.
+ * @param fhttp The FlipperHTTP context
+ * @note       Enable it before the lines you want arrive, and keep reading them with
+ *             flipper_http_receive_line, the RX thread waits when the queue is full.
+ */
+bool flipper_http_line_queue_enable(FlipperHTTP* fhttp);
+
+/**
+ * @brief      Take the oldest line from the line queue.
+ * @return     The length of the line, 0 when none arrived within the timeout.
+ * @param fhttp The FlipperHTTP context
+ * @param      line     Buffer of at least RX_LINE_BUFFER_SIZE bytes, the line is null-terminated.
+ * @param      timeout  Ticks to wait for a line.
+ */
+size_t flipper_http_receive_line(FlipperHTTP* fhttp, char* line, uint32_t timeout);
+
 /**
  * @brief      Append received data to a file.
  * @return     true if the data was appended successfully, false otherwise.
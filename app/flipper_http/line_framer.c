@@ -0,0 +1,59 @@
+// File: line_framer.c
+#include "line_framer.h"
+
+#include <string.h>
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+void line_framer_init(LineFramer* framer, char* buffer, size_t capacity) {
+    framer->buffer = buffer;
+    framer->capacity = capacity;
+    framer->length = 0;
+}
+
+static void line_framer_emit(LineFramer* framer, LineFramerCallback callback, void* context) {
+    framer->buffer[framer->length] = '\0';
+    callback(framer->buffer, framer->length, context);
+    framer->length = 0;
+}
+
+void line_framer_feed(
+    LineFramer* framer,
+    const char* data,
+    size_t size,
+    LineFramerCallback callback,
+    void* context) {
+    const char* end = data + size;
+    while(data < end) {
+        const char* newline = memchr(data, '\n', end - data);
+        const char* stop = newline ? newline : end;
+
+        // copy up to the newline in as few pieces as the buffer allows
+        while(data < stop) {
+            if(framer->length == framer->capacity - 1) {
+                line_framer_emit(framer, callback, context); // too long, deliver what fits
+            }
+            size_t room = framer->capacity - 1 - framer->length;
+            size_t count = (size_t)(stop - data) < room ? (size_t)(stop - data) : room;
+            memcpy(framer->buffer + framer->length, data, count);
+            framer->length += count;
+            data += count;
+        }
+        if(newline) {
+            line_framer_emit(framer, callback, context);
+            data = newline + 1;
+        }
+    }
+}
+
+const char* line_trim(const char* line, size_t* length) {
+    const char* end = line + *length;
+    while(line < end && is_space(*line))
+        line++;
+    while(end > line && is_space(end[-1]))
+        end--;
+    *length = (size_t)(end - line);
+    return line;
+}
@@ -0,0 +1,48 @@
+// File: line_framer.h
+// Splits the UART byte stream into lines without copying a byte at a time.
+// Plain C without Furi, so it builds and is checked on a host too (see bench/line_framer_bench.c).
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Called with every complete line, null-terminated and without its '\n'. The line lives in the
+// framer's buffer and is only valid during the call.
+typedef void (*LineFramerCallback)(char* line, size_t length, void* context);
+
+typedef struct {
+    char* buffer;
+    size_t capacity; // a line longer than capacity - 1 is delivered in pieces
+    size_t length; // of the line collected so far
+} LineFramer;
+
+/**
+ * @brief      Start framing into buffer.
+ * @param      framer    The framer.
+ * @param      buffer    Holds the line being collected, capacity bytes.
+ * @param      capacity  Size of buffer, at least 2.
+ */
+void line_framer_init(LineFramer* framer, char* buffer, size_t capacity);
+
+/**
+ * @brief      Feed a block of received bytes, calling back for each line it completes.
+ * @param      framer    The framer.
+ * @param      data      The received bytes.
+ * @param      size      Number of bytes.
+ * @param      callback  Called for each complete line.
+ * @param      context   Passed to the callback.
+ */
+void line_framer_feed(
+    LineFramer* framer,
+    const char* data,
+    size_t size,
+    LineFramerCallback callback,
+    void* context);
+
+/**
+ * @brief      Leading and trailing whitespace trimmed off line, without copying it.
+ * @return     The first character that is not whitespace, *length is updated to the trimmed length.
+ * @param      line    The line, need not be null-terminated.
+ * @param      length  In: the line's length, out: the trimmed length.
+ */
+const char* line_trim(const char* line, size_t* length);
@@ -5,6 +5,8 @@
 #include <notification/notification.h>
 #include <flipper_http/flipper_http.h>
 
+#include "chunk_decoder.h"
+
 #define TAG                   "PAINTERS"
 #define MAP_WIDTH             500
 #define MAP_HEIGHT            500
@@ -12,14 +14,30 @@
 #define SCREEN_HEIGHT         64
 #define PAINTED_BYTES_SIZE    ((MAP_WIDTH * MAP_HEIGHT + 7) / 8) // 1 byte = 8 bits
 #define ZOOM_MESSAGE_DURATION 2000 // 2 seconds in milliseconds
-#define PIXEL_PLACE_TIMEOUT   1050 // 1.05 second in milliseconds
+#define PIXEL_PLACE_TIMEOUT   1050 // 1.05 second in milliseconds, until the server tells otherwise
+#define PIXEL_TIMEOUT_MARGIN  50 // added to the server timeout for network jitter
 #define MAP_SYNC_INTERVAL     (1.5 * 60 * 1000) // 1.5 minutes in milliseconds
 #define WEBSOCKET_URL         "ws://painters.segerend.nl"
 #define WEBSOCKET_PORT        80
 #define CHUNK_SIZE            1280
+#define CHUNK_BUFFER_SIZE     (RX_LINE_BUFFER_SIZE / 2) // the most bytes one line of hex can hold
+#define OVERVIEW_LEVEL        3 // [MAP/OVERVIEW:3], one cell per 8x8 block of the map
+#define OVERVIEW_CELL         (1 << OVERVIEW_LEVEL)
+#define OVERVIEW_SIZE         ((MAP_WIDTH + OVERVIEW_CELL - 1) / OVERVIEW_CELL) // 63, fits the screen height
+#define OVERVIEW_BYTES        ((OVERVIEW_SIZE * OVERVIEW_SIZE + 7) / 8)
+#define OVERVIEW_REQUEST      "[MAP/OVERVIEW:3]" // OVERVIEW_LEVEL
+#define HASH_DEPTH            4 // [MAP/HASH] paths name a tile after 4 quadrant digits
+#define HASH_TILE_SIZE        32
+#define REPAIR_QUEUE_SIZE     16 // hash and tile requests waiting to be sent
+#define REPAIR_POLL_INTERVAL  100 // milliseconds, how soon queued requests go out without input
+#define LISTENER_STOP_POLL    100 // milliseconds the listener waits for a line before checking for a stop
+#define CANVAS_CACHE_PATH     APP_DATA_PATH("canvas.bin")
+#define CANVAS_CACHE_MAGIC    0x31435450 // "PTC1"
+#define LINK_RATE             (BAUDRATE / 10) // bytes per second the UART to the WiFi board carries, 8N1
 
 
 typedef enum {
+    ZoomOverview = 0, // the whole map downsampled by the server, no painting
     ZoomOut = 1,
     Zoom1x = 3,
     Zoom2x = 4,
@@ -34,6 +52,27 @@ typedef struct {
     int16_t x, y;
 } Camera;
 
+// Pixel placed locally before the server confirmed it
+typedef struct {
+    int16_t x, y;
+    bool previous_color;
+    bool active;
+} PendingPixel;
+
+// Start of the canvas cache file, followed by the painted bytes
+typedef struct {
+    uint32_t magic;
+    uint16_t width;
+    uint16_t height;
+    uint32_t root_hash; // of the bytes, checks the file and tells the server what we have
+} CanvasCacheHeader;
+
+// A [MAP/HASH:path] or [MAP/TILE:path] request found by the listener, sent from the main loop
+typedef struct {
+    char path[HASH_DEPTH + 1];
+    bool tile;
+} RepairRequest;
+
 typedef struct {
     FlipperHTTP* fhttp;
     ViewPort* vp;
@@ -44,8 +83,18 @@ typedef struct {
     ZoomLevel zoom;
     uint32_t zoom_message_start_time;
     uint32_t pixel_place_timeout_start_time;
+    uint32_t pixel_place_timeout; // milliseconds, follows [WAKE] and [TIMEOUT:n] from the server
+    PendingPixel pending_pixel;
     int connected;
-    char* last_server_response;
+    bool syncing; // a paced sync is still sending the canvas beyond our view
+    char line[RX_LINE_BUFFER_SIZE]; // the message the listener is working on
+    uint8_t overview[OVERVIEW_BYTES]; // rows back to back, LSB first like painted_bytes
+    bool overview_valid;
+    RepairRequest repair_queue[REPAIR_QUEUE_SIZE];
+    uint8_t repair_count;
+    bool repair_overflow; // more drift than the queue holds, a full [MAP/SYNC] is cheaper
+    uint32_t sync_retry_time; // tick to ask again after [MAP/RETRY], 0 when not waiting
+    uint8_t chunk_buffer[CHUNK_BUFFER_SIZE]; // a chunk decoded outside the mutex
 } PaintData;
 
 static void clamp_cursor(Cursor* cursor) {
@@ -56,6 +105,7 @@ static void clamp_cursor(Cursor* cursor) {
 }
 
 static void clamp_camera(Camera* camera, ZoomLevel zoom) {
+    if(zoom == ZoomOverview) return; // the overview always shows the whole map
     int view_w = SCREEN_WIDTH / zoom;
     int view_h = SCREEN_HEIGHT / zoom;
     if(camera->x < 0) camera->x = 0;
@@ -65,6 +115,7 @@ static void clamp_camera(Camera* camera, ZoomLevel zoom) {
 }
 
 static void center_camera_on_cursor(PaintData* state) {
+    if(state->zoom == ZoomOverview) return;
     int view_w = SCREEN_WIDTH / state->zoom;
     int view_h = SCREEN_HEIGHT / state->zoom;
 
@@ -97,6 +148,38 @@ static void draw_board(Canvas* canvas, const PaintData* state) {
     }
 }
 
+// The overview centered on the screen, one dot per cell
+static void draw_overview(Canvas* canvas, const PaintData* state) {
+    int offset_x = (SCREEN_WIDTH - OVERVIEW_SIZE) / 2;
+    int offset_y = (SCREEN_HEIGHT - OVERVIEW_SIZE) / 2;
+
+    canvas_set_color(canvas, ColorBlack);
+    canvas_draw_frame(canvas, offset_x - 1, offset_y - 1, OVERVIEW_SIZE + 2, OVERVIEW_SIZE + 2);
+    if(!state->overview_valid) {
+        canvas_draw_str_aligned(canvas, 64, 32, AlignCenter, AlignCenter, "...");
+        return;
+    }
+    for(int y = 0; y < OVERVIEW_SIZE; y++) {
+        for(int x = 0; x < OVERVIEW_SIZE; x++) {
+            int index = y * OVERVIEW_SIZE + x;
+            if(state->overview[index / 8] & (1 << (index % 8))) {
+                canvas_draw_dot(canvas, offset_x + x, offset_y + y);
+            }
+        }
+    }
+}
+
+static void draw_overview_cursor(Canvas* canvas, const PaintData* state) {
+    int screen_x = (SCREEN_WIDTH - OVERVIEW_SIZE) / 2 + state->cursor.x / OVERVIEW_CELL;
+    int screen_y = (SCREEN_HEIGHT - OVERVIEW_SIZE) / 2 + state->cursor.y / OVERVIEW_CELL;
+
+    // a cross, so it stays visible on painted and empty cells
+    canvas_set_color(canvas, ColorXOR);
+    canvas_draw_line(canvas, screen_x - 2, screen_y, screen_x + 2, screen_y);
+    canvas_draw_line(canvas, screen_x, screen_y - 2, screen_x, screen_y - 1);
+    canvas_draw_line(canvas, screen_x, screen_y + 1, screen_x, screen_y + 2);
+}
+
 static void draw_cursor(Canvas* canvas, const PaintData* state) {
     uint8_t tile_size = state->zoom;
     int screen_x = (state->cursor.x - state->camera.x) * tile_size;
@@ -120,14 +203,18 @@ static void draw_ui(Canvas* canvas, const PaintData* state) {
         canvas_draw_rbox(canvas, 0, 0, 50, 14, 2);
 
         char zoom_text[32];
-        snprintf(zoom_text, sizeof(zoom_text), "Zoom: %dx", state->zoom);
+        if(state->zoom == ZoomOverview) {
+            snprintf(zoom_text, sizeof(zoom_text), "Overview");
+        } else {
+            snprintf(zoom_text, sizeof(zoom_text), "Zoom: %dx", state->zoom);
+        }
         canvas_set_color(canvas, ColorBlack);
         canvas_draw_str(canvas, 2, 10, zoom_text);
     }
     if (state->pixel_place_timeout_start_time > 0 &&
-       (current_time - state->pixel_place_timeout_start_time) < PIXEL_PLACE_TIMEOUT) {
+       (current_time - state->pixel_place_timeout_start_time) < state->pixel_place_timeout) {
         // seconds to wait
-        uint32_t seconds = (PIXEL_PLACE_TIMEOUT - (current_time - state->pixel_place_timeout_start_time)) / 1000;
+        uint32_t seconds = (state->pixel_place_timeout - (current_time - state->pixel_place_timeout_start_time)) / 1000;
         char timeout_text[32];
         snprintf(timeout_text, sizeof(timeout_text), "Wait: %ld seconds", seconds);
 
@@ -141,7 +228,12 @@ void paint_draw_callback(Canvas* canvas, void* ctx) {
 
     furi_mutex_acquire(state->mutex, FuriWaitForever);
 
-    if(state->connected == 2) {
+    if(state->connected == 2 && state->zoom == ZoomOverview) {
+        canvas_clear(canvas);
+        draw_overview(canvas, state);
+        draw_overview_cursor(canvas, state);
+        draw_ui(canvas, state);
+    } else if(state->connected == 2) {
         canvas_clear(canvas);
         draw_cursor(canvas, state);
         draw_board(canvas, state);
@@ -149,6 +241,12 @@ void paint_draw_callback(Canvas* canvas, void* ctx) {
     } else if(state->connected == 0) {
         canvas_set_font(canvas, FontPrimary);
         canvas_draw_str(canvas, 1, 10, "Not connected to server");
+    } else if(state->connected == 1 && state->overview_valid) {
+        // the overview arrives before the chunks, show it while the canvas loads
+        canvas_clear(canvas);
+        draw_overview(canvas, state);
+        canvas_set_font(canvas, FontSecondary);
+        canvas_draw_str(canvas, 1, 8, "Loading");
     } else if(state->connected == 1) {
         canvas_set_font(canvas, FontPrimary);
         canvas_draw_str(canvas, 1, 10, "Connected to server");
@@ -166,9 +264,15 @@ static void cycle_zoom(PaintData* state) {
     // ZoomLevel old_zoom = state->zoom;
 
     switch(state->zoom) {
-    case ZoomOut:
+    case ZoomOverview:
         state->zoom = Zoom1x;
         break;
+    case ZoomOut:
+        // ask for a fresh overview, it is not kept up to date with pixel updates
+        state->zoom = ZoomOverview;
+        state->zoom_message_start_time = furi_get_tick();
+        flipper_http_send_data(state->fhttp, OVERVIEW_REQUEST);
+        return;
     case Zoom1x:
         state->zoom = Zoom2x;
         break;
@@ -232,100 +336,424 @@ static void send_pixel(FlipperHTTP* fhttp, int x, int y, int color) {
     }
 }
 
+// Parse up to count ':' separated numbers, returns how many were read
+static int parse_numbers(const char* text, long* values, int count) {
+    int parsed = 0;
+    while(parsed < count) {
+        char* end;
+        values[parsed] = strtol(text, &end, 10);
+        if(end == text) break;
+        parsed++;
+        if(*end != ':') break;
+        text = end + 1;
+    }
+    return parsed;
+}
+
+// 32-bit FNV-1a, the hash the server's tree uses
+static uint32_t fnv1a(uint32_t hash, const uint8_t* bytes, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// A tile hashes its rows, each packed LSB first into whole bytes, edge tiles are clipped to the map
+static uint32_t tile_hash(const uint8_t* painted_bytes, int tile_x, int tile_y) {
+    int left = tile_x * HASH_TILE_SIZE;
+    int top = tile_y * HASH_TILE_SIZE;
+    int width = MAP_WIDTH - left < HASH_TILE_SIZE ? MAP_WIDTH - left : HASH_TILE_SIZE;
+    int height = MAP_HEIGHT - top < HASH_TILE_SIZE ? MAP_HEIGHT - top : HASH_TILE_SIZE;
+    uint32_t hash = 2166136261u;
+    for(int y = top; y < top + height; y++) {
+        uint8_t row[HASH_TILE_SIZE / 8] = {0};
+        for(int x = 0; x < width; x++) {
+            int index = y * MAP_WIDTH + left + x;
+            if(painted_bytes[index / 8] & (1 << (index % 8))) {
+                row[x / 8] |= 1 << (x % 8);
+            }
+        }
+        hash = fnv1a(hash, row, (width + 7) / 8);
+    }
+    return hash;
+}
+
+// A node hashes its four child hashes as little endian words
+static uint32_t node_hash(const uint8_t* painted_bytes, int depth, int x, int y) {
+    if(depth == HASH_DEPTH) return tile_hash(painted_bytes, x, y);
+    uint8_t children[16];
+    for(int quadrant = 0; quadrant < 4; quadrant++) {
+        uint32_t child = node_hash(painted_bytes, depth + 1, x * 2 + (quadrant & 1), y * 2 + (quadrant >> 1));
+        for(int i = 0; i < 4; i++) {
+            children[quadrant * 4 + i] = (uint8_t)(child >> (8 * i));
+        }
+    }
+    return fnv1a(2166136261u, children, sizeof(children));
+}
+
+static void queue_repair(PaintData* state, const char* path, int length, bool tile) {
+    if(state->repair_count == REPAIR_QUEUE_SIZE) {
+        state->repair_overflow = true;
+        return;
+    }
+    RepairRequest* request = &state->repair_queue[state->repair_count++];
+    memcpy(request->path, path, length);
+    request->path[length] = '\0';
+    request->tile = tile;
+}
+
+// The line queue was full and lines were lost, whatever they changed is found by walking the
+// hash tree from the root, or by syncing again when the canvas is still coming in
+static void repair_lost_lines(PaintData* state) {
+    if(state->connected == 2 && !state->syncing) {
+        queue_repair(state, "", 0, false);
+    } else if(state->connected) {
+        state->repair_overflow = true;
+    }
+}
+
+// [MAP/HASH:path]NODE:C0:C1:C2:C3, ask further down for every child that differs from our copy
+static void check_hashes(PaintData* state, const char* path, int length, const char* hashes) {
+    if(length >= HASH_DEPTH) return; // a tile hash has no children to compare
+    int x = 0, y = 0;
+    for(int i = 0; i < length; i++) {
+        if(path[i] < '0' || path[i] > '3') return;
+        x = x * 2 + ((path[i] - '0') & 1);
+        y = y * 2 + ((path[i] - '0') >> 1);
+    }
+    char* end;
+    strtoul(hashes, &end, 16); // the node itself
+    for(int quadrant = 0; quadrant < 4; quadrant++) {
+        if(*end != ':') return;
+        const char* text = end + 1;
+        uint32_t remote = strtoul(text, &end, 16);
+        if(end == text) return;
+        uint32_t local =
+            node_hash(state->painted_bytes, length + 1, x * 2 + (quadrant & 1), y * 2 + (quadrant >> 1));
+        if(remote != local) {
+            char child[HASH_DEPTH + 1];
+            memcpy(child, path, length);
+            child[length] = '0' + quadrant;
+            queue_repair(state, child, length + 1, length + 1 == HASH_DEPTH);
+        }
+    }
+}
+
+// Keep the canvas for the next start, so it only needs the tiles that changed meanwhile
+static void save_canvas_cache(const uint8_t* painted_bytes) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, APP_DATA_PATH(""));
+    furi_record_close(RECORD_STORAGE);
+
+    CanvasCacheHeader header = {
+        .magic = CANVAS_CACHE_MAGIC,
+        .width = MAP_WIDTH,
+        .height = MAP_HEIGHT,
+        .root_hash = node_hash(painted_bytes, 0, 0, 0),
+    };
+    if(!flipper_http_append_to_file(&header, sizeof(header), true, CANVAS_CACHE_PATH) ||
+       !flipper_http_append_to_file(painted_bytes, PAINTED_BYTES_SIZE, false, CANVAS_CACHE_PATH)) {
+        FURI_LOG_E(TAG, "Failed to save the canvas cache");
+    }
+}
+
+// Restore the saved canvas, false when there is none or it doesn't match its hash
+static bool load_canvas_cache(uint8_t* painted_bytes, uint32_t* root_hash) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    CanvasCacheHeader header;
+    bool loaded = storage_file_open(file, CANVAS_CACHE_PATH, FSAM_READ, FSOM_OPEN_EXISTING) &&
+                  storage_file_size(file) == sizeof(header) + PAINTED_BYTES_SIZE &&
+                  storage_file_read(file, &header, sizeof(header)) == sizeof(header) &&
+                  header.magic == CANVAS_CACHE_MAGIC && header.width == MAP_WIDTH &&
+                  header.height == MAP_HEIGHT &&
+                  storage_file_read(file, painted_bytes, PAINTED_BYTES_SIZE) == PAINTED_BYTES_SIZE;
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+
+    if(loaded && node_hash(painted_bytes, 0, 0, 0) != header.root_hash) {
+        FURI_LOG_E(TAG, "Canvas cache is corrupt, ignoring it");
+        loaded = false;
+    }
+    if(!loaded) {
+        memset(painted_bytes, 0, PAINTED_BYTES_SIZE);
+        return false;
+    }
+    *root_hash = header.root_hash;
+    return true;
+}
+
+// Send what the listener queued, outside the mutex since sending waits on the UART
+static void send_repair_requests(PaintData* state) {
+    RepairRequest requests[REPAIR_QUEUE_SIZE];
+    furi_mutex_acquire(state->mutex, FuriWaitForever);
+    uint8_t count = state->repair_count;
+    bool overflow = state->repair_overflow;
+    int16_t view_y = state->camera.y;
+    // after [MAP/RETRY] a loaded canvas walks the hash tree again, the server's answers
+    // show what still differs, without one only a sync helps
+    bool retry = state->sync_retry_time != 0 && (int32_t)(furi_get_tick() - state->sync_retry_time) >= 0;
+    bool walk = retry && state->connected == 2;
+    if(retry) {
+        state->sync_retry_time = 0;
+        overflow = overflow || !walk;
+    }
+    memcpy(requests, state->repair_queue, count * sizeof(RepairRequest));
+    state->repair_count = 0;
+    state->repair_overflow = false;
+    furi_mutex_release(state->mutex);
+
+    if(overflow) {
+        // the server sends the rows on screen first
+        char sync[24];
+        snprintf(sync, sizeof(sync), "[MAP/SYNC:%d]", view_y);
+        flipper_http_send_data(state->fhttp, sync);
+        return;
+    }
+    if(walk) {
+        flipper_http_send_data(state->fhttp, "[MAP/HASH:]");
+    }
+    for(uint8_t i = 0; i < count; i++) {
+        char message[32];
+        snprintf(message, sizeof(message), "[MAP/%s:%s]", requests[i].tile ? "TILE" : "HASH", requests[i].path);
+        flipper_http_send_data(state->fhttp, message);
+    }
+}
+
+static void set_map_pixel(uint8_t* painted_bytes, long x, long y, bool color) {
+    if(x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) return;
+    int index = y * MAP_WIDTH + x;
+    if(color) {
+        painted_bytes[index / 8] |= (1 << (index % 8));
+    } else {
+        painted_bytes[index / 8] &= ~(1 << (index % 8));
+    }
+}
+
+// Apply a [PIXELS] batch: "r:x,y,length,c", "b:x,y,width,height,c" or "l:c:x,y;x,y;..."
+static void apply_pixel_batch(uint8_t* painted_bytes, const char* batch) {
+    char* end;
+    if(batch[0] == 'r' || batch[0] == 'b') {
+        long values[5];
+        int count = batch[0] == 'r' ? 4 : 5;
+        const char* text = batch + 2;
+        for(int i = 0; i < count; i++) {
+            values[i] = strtol(text, &end, 10);
+            if(end == text) return;
+            text = end + 1;
+        }
+        long height = batch[0] == 'r' ? 1 : values[3];
+        bool color = values[count - 1] == 1;
+        if(values[2] > MAP_WIDTH || height > MAP_HEIGHT) return;
+        for(long y = values[1]; y < values[1] + height; y++) {
+            for(long x = values[0]; x < values[0] + values[2]; x++) {
+                set_map_pixel(painted_bytes, x, y, color);
+            }
+        }
+    } else if(batch[0] == 'l') {
+        bool color = batch[2] == '1';
+        const char* text = batch + 3;
+        while(*text == ':' || *text == ';') {
+            long x = strtol(text + 1, &end, 10);
+            if(*end != ',') return;
+            long y = strtol(end + 1, &end, 10);
+            set_map_pixel(painted_bytes, x, y, color);
+            text = end;
+        }
+    }
+}
+
 long int websocket_listener_thread(void* context) {
     PaintData* state = (PaintData*)context;
     FlipperHTTP* fhttp = state->fhttp;
 
     uint32_t chunk_count = 0;
+    size_t lines_dropped = fhttp->lines_dropped;
 
     while(furi_thread_flags_get() != WorkerEvtStop) {
+        // Every line in the order it arrived, the timeout only bounds how long a stop waits.
+        // Chunks are decoded before taking the mutex so the draw callback doesn't wait for them.
+        size_t length = flipper_http_receive_line(fhttp, state->line, LISTENER_STOP_POLL);
+        if(fhttp->lines_dropped != lines_dropped) {
+            lines_dropped = fhttp->lines_dropped;
+            furi_mutex_acquire(state->mutex, FuriWaitForever);
+            repair_lost_lines(state);
+            furi_mutex_release(state->mutex);
+        }
+        if(length == 0) continue;
+        const char* message = state->line;
+        ChunkInfo chunk;
+        ChunkResult chunk_result =
+            chunk_decode(message, length, state->chunk_buffer, CHUNK_BUFFER_SIZE, PAINTED_BYTES_SIZE, &chunk);
+
         furi_mutex_acquire(state->mutex, FuriWaitForever);
 
-        if(fhttp->last_response && strlen(fhttp->last_response) > 0) {
-            if(!state->last_server_response || strcmp(fhttp->last_response, state->last_server_response) != 0) {
-                FURI_LOG_I(TAG, "Received message: %s", fhttp->last_response);
-
-                const char* message = fhttp->last_response;
-
-                // Check if it starts with [MAP/CHUNK:
-                if (strncmp(message, "[MAP/CHUNK:", 11) == 0) {
-                    const char* first_colon = strchr(message + 11, ':');
-                    const char* bracket_pos = strchr(message, ']');
-                    if (first_colon && bracket_pos) {
-                        // Extract chunk id and offset
-                        // int chunk_id = atoi(message + 11);
-                        int start_pos = atoi(first_colon + 1);
-                
-                        if (start_pos < PAINTED_BYTES_SIZE) {
-                            const uint8_t* data = (const uint8_t*)(bracket_pos + 1);
-                            size_t data_len = strlen((const char*)data);
-                
-                            size_t num_bytes = data_len / 2;
-                            if (start_pos + num_bytes > PAINTED_BYTES_SIZE) {
-                                num_bytes = PAINTED_BYTES_SIZE - start_pos;
-                            }
-                
-                            for (size_t i = 0; i < num_bytes; ++i) {
-                                char byte_str[3] = { data[i*2], data[i*2+1], '\0' };
-                                uint8_t byte = (uint8_t)strtoul(byte_str, NULL, 16);
-                                state->painted_bytes[start_pos + i] = byte;
-                            }
-                
-                            chunk_count++;
-                        }
-                    }
-                }                
-
-                //  if [PIXEL]x:y:c: then update the pixel in the painted bytes array
-                else if(strncmp(message, "[PIXEL]", 7) == 0) {
-                    const char* x_pos = strstr(message, "x:");
-                    const char* y_pos = strstr(message, "y:");
-                    const char* c_pos = strstr(message, "c:");
-
-                    if(x_pos && y_pos && c_pos) {
-                        int x = atoi(x_pos + 2);
-                        int y = atoi(y_pos + 2);
-                        int color = atoi(c_pos + 2);
-
-                        if(x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT) {
-                            int index = y * MAP_WIDTH + x;
-                            int byte_index = index / 8;
-                            int bit_index = index % 8;
-
-                            if(color == 1) {
-                                state->painted_bytes[byte_index] |= (1 << bit_index); // set color to black
-                            } else {
-                                state->painted_bytes[byte_index] &= ~(1 << bit_index); // set color to white
-                            }
-                        }
+        FURI_LOG_D(TAG, "Received message: %s", message);
+
+        if(chunk_result == ChunkOk) {
+            memcpy(state->painted_bytes + chunk.start, state->chunk_buffer, chunk.size);
+            chunk_count++;
+        } else if(chunk_result != ChunkNotChunk) {
+            FURI_LOG_E(TAG, "Dropping malformed chunk, error %d", chunk_result);
+        }
+
+        //  if [PIXEL]x:y:c: then update the pixel in the painted bytes array
+        else if(strncmp(message, "[PIXEL]", 7) == 0) {
+            const char* x_pos = strstr(message, "x:");
+            const char* y_pos = strstr(message, "y:");
+            const char* c_pos = strstr(message, "c:");
+
+            if(x_pos && y_pos && c_pos) {
+                int x = atoi(x_pos + 2);
+                int y = atoi(y_pos + 2);
+                int color = atoi(c_pos + 2);
+
+                if(x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT) {
+                    int index = y * MAP_WIDTH + x;
+                    int byte_index = index / 8;
+                    int bit_index = index % 8;
+
+                    if(color == 1) {
+                        state->painted_bytes[byte_index] |= (1 << bit_index); // set color to black
+                    } else {
+                        state->painted_bytes[byte_index] &= ~(1 << bit_index); // set color to white
                     }
                 }
+            }
+        }
 
-                // When [SOCKET/STOP] is received, stop the websocket
-                else if(strncmp(message, "[SOCKET/STOPPED]", 13) == 0) {
-                    FURI_LOG_I(TAG, "Received [SOCKET/STOPPED] message, stopping websocket connection");
-                    flipper_http_websocket_stop(fhttp);
-                    state->connected = 0; // Set connected to 0, disconnected from server
-                    view_port_update(state->vp);
+        // [MAP/CLEAR] starts a paced sync, the chunks that follow leave out the white runs
+        else if(strcmp(message, "[MAP/CLEAR]") == 0) {
+            memset(state->painted_bytes, 0, PAINTED_BYTES_SIZE);
+            state->syncing = true;
+        }
+
+        // [MAP/VIEW/END], the rows on screen have arrived, show the board while the rest streams in
+        else if(strcmp(message, "[MAP/VIEW/END]") == 0) {
+            state->connected = 2;
+        }
+
+        // [PIXELS]..., a stroke or shape placed in one frame
+        else if(strncmp(message, "[PIXELS]", 8) == 0) {
+            apply_pixel_batch(state->painted_bytes, message + 8);
+        }
+
+        // [MAP/OVERVIEW:level:width:height]HEX, the whole map downsampled for the overview
+        else if(strncmp(message, "[MAP/OVERVIEW:", 14) == 0) {
+            long values[3];
+            const char* bracket_pos = strchr(message, ']');
+            if(bracket_pos && parse_numbers(message + 14, values, 3) == 3 &&
+               values[0] == OVERVIEW_LEVEL && values[1] == OVERVIEW_SIZE &&
+               values[2] == OVERVIEW_SIZE && strlen(bracket_pos + 1) >= OVERVIEW_BYTES * 2) {
+                state->overview_valid = chunk_hex_decode(bracket_pos + 1, state->overview, OVERVIEW_BYTES);
+            }
+        }
+
+        // [MAP/HASH:path]..., compare the children with our copy
+        else if(strncmp(message, "[MAP/HASH:", 10) == 0) {
+            const char* bracket_pos = strchr(message, ']');
+            if(bracket_pos) {
+                check_hashes(state, message + 10, bracket_pos - (message + 10), bracket_pos + 1);
+            }
+        }
+
+        // [MAP/TILE:path:x:y:width:height]HEX, a tile that differed, rows packed LSB first
+        else if(strncmp(message, "[MAP/TILE:", 10) == 0) {
+            long values[4];
+            const char* numbers = strchr(message + 10, ':');
+            const char* bracket_pos = strchr(message, ']');
+            if(numbers && bracket_pos && parse_numbers(numbers + 1, values, 4) == 4 &&
+               values[2] > 0 && values[2] <= HASH_TILE_SIZE && values[3] > 0 && values[3] <= HASH_TILE_SIZE) {
+                size_t row_bytes = (values[2] + 7) / 8;
+                const char* hex = bracket_pos + 1;
+                // decoded whole before any pixel is set, a bad digit leaves the tile as it was
+                uint8_t tile[HASH_TILE_SIZE / 8 * HASH_TILE_SIZE];
+                if(strlen(hex) >= row_bytes * values[3] * 2 &&
+                   chunk_hex_decode(hex, tile, row_bytes * values[3])) {
+                    for(long y = 0; y < values[3]; y++) {
+                        const uint8_t* row = tile + y * row_bytes;
+                        for(long x = 0; x < values[2]; x++) {
+                            set_map_pixel(
+                                state->painted_bytes, values[0] + x, values[1] + y, row[x / 8] & (1 << (x % 8)));
+                        }
+                    }
                 }
+            }
+        }
 
-                // Update last_server_response
-                if(state->last_server_response) free(state->last_server_response);
-                state->last_server_response = strdup(fhttp->last_response);
+        // [PIXEL/ACK:x:y:version], the server accepted our pixel, the coordinates are enough to match it
+        else if(strncmp(message, "[PIXEL/ACK:", 11) == 0) {
+            long values[2];
+            if(parse_numbers(message + 11, values, 2) == 2 && state->pending_pixel.active &&
+               state->pending_pixel.x == values[0] && state->pending_pixel.y == values[1]) {
+                state->pending_pixel.active = false;
+            }
+        }
 
-                // if response is [MAP/END], set connected to 2, little bit dirty, maybe also check in the future if all chunks are received
-                if(strcmp(fhttp->last_response, "[MAP/END]") == 0) {
-                    state->connected = 2; // Set connected to 2, connected to server and loaded the canvas
+        // [PIXEL/REJECT:x:y:remaining_ms], still in the cooldown, undo the optimistic pixel
+        else if(strncmp(message, "[PIXEL/REJECT:", 14) == 0) {
+            long values[3];
+            if(parse_numbers(message + 14, values, 3) == 3) {
+                if(state->pending_pixel.active && state->pending_pixel.x == values[0] &&
+                   state->pending_pixel.y == values[1]) {
+                    int index = state->pending_pixel.y * MAP_WIDTH + state->pending_pixel.x;
+                    int byte_index = index / 8;
+                    int bit_index = index % 8;
+                    if(state->pending_pixel.previous_color) {
+                        state->painted_bytes[byte_index] |= (1 << bit_index);
+                    } else {
+                        state->painted_bytes[byte_index] &= ~(1 << bit_index);
+                    }
+                    state->pending_pixel.active = false;
                 }
+                // show the real remaining time
+                uint32_t remaining = values[2];
+                if(remaining > state->pixel_place_timeout) remaining = state->pixel_place_timeout;
+                state->pixel_place_timeout_start_time =
+                    furi_get_tick() - (state->pixel_place_timeout - remaining);
+            }
+        }
 
-                // Redraw screen
-                view_port_update(state->vp);
+        // The server adapts the pixel timeout to its load, [WAKE:...:t:n:...] and [TIMEOUT:n]
+        else if(strncmp(message, "[TIMEOUT:", 9) == 0) {
+            int timeout = atoi(message + 9);
+            if(timeout > 0) {
+                state->pixel_place_timeout = timeout + PIXEL_TIMEOUT_MARGIN;
+            }
+        }
+        else if(strncmp(message, "[WAKE:", 6) == 0) {
+            const char* t_pos = strstr(message, ":t:");
+            if(t_pos && atoi(t_pos + 3) > 0) {
+                state->pixel_place_timeout = atoi(t_pos + 3) + PIXEL_TIMEOUT_MARGIN;
             }
         }
 
-        furi_mutex_release(state->mutex);
+        // [MAP/RETRY:seconds], the server refused a sync or a repair, ask again when our budget refilled
+        else if(strncmp(message, "[MAP/RETRY:", 11) == 0) {
+            int seconds = atoi(message + 11);
+            state->sync_retry_time = furi_get_tick() + furi_ms_to_ticks((seconds > 0 ? seconds : 1) * 1000);
+            if(state->sync_retry_time == 0) state->sync_retry_time = 1;
+        }
+
+        // When [SOCKET/STOP] is received, stop the websocket
+        else if(strncmp(message, "[SOCKET/STOPPED]", 13) == 0) {
+            FURI_LOG_I(TAG, "Received [SOCKET/STOPPED] message, stopping websocket connection");
+            flipper_http_websocket_stop(fhttp);
+            state->connected = 0; // Set connected to 0, disconnected from server
+            view_port_update(state->vp);
+        }
+
+        // if response is [MAP/END], set connected to 2, little bit dirty, maybe also check in the future if all chunks are received
+        if(strcmp(message, "[MAP/END]") == 0) {
+            state->connected = 2; // Set connected to 2, connected to server and loaded the canvas
+            state->syncing = false;
+        }
 
-        furi_delay_ms(10);
+        // Redraw screen
+        view_port_update(state->vp);
+
+        furi_mutex_release(state->mutex);
     }
     return 0;
 }
@@ -350,6 +778,7 @@ int32_t painters_app(void* p) {
     }
 
     state->connected = false;
+    state->syncing = false;
 
     // Center the cursor in the middle of the map on start
     state->cursor.x = MAP_WIDTH / 2;
@@ -358,6 +787,13 @@ int32_t painters_app(void* p) {
     state->camera = (Camera){.x = 0, .y = 0};
     state->zoom = Zoom2x;
     state->zoom_message_start_time = 0;
+    state->pixel_place_timeout_start_time = 0;
+    state->pixel_place_timeout = PIXEL_PLACE_TIMEOUT;
+    state->pending_pixel.active = false;
+    state->overview_valid = false;
+    state->repair_count = 0;
+    state->repair_overflow = false;
+    state->sync_retry_time = 0;
 
     center_camera_on_cursor(state);
 
@@ -369,7 +805,8 @@ int32_t painters_app(void* p) {
         furi_message_queue_free(queue);
         return -1;
     }
-    memset(state->painted_bytes, 0, PAINTED_BYTES_SIZE);
+    uint32_t cached_hash = 0;
+    bool cached = load_canvas_cache(state->painted_bytes, &cached_hash);
 
     ViewPort* vp = view_port_alloc();
     if(!vp) {
@@ -413,16 +850,34 @@ int32_t painters_app(void* p) {
 
     flipper_http_websocket_stop(fhttp); // Stop any existing websocket connection
 
+    // before the websocket starts, so the listener gets every line from [WAKE] on
+    if(!flipper_http_line_queue_enable(fhttp)) {
+        FURI_LOG_E(TAG, "Failed to allocate the line queue");
+        return -1;
+    }
+
     furi_delay_ms(500); // Wait for a second before starting the websocket
     if(!game_start_websocket(fhttp)) {
         FURI_LOG_E(TAG, "Failed to start websocket connection");
         return -1;
     } else {
-        char name[16];
-        snprintf(name, sizeof(name), "[NAME]%s", furi_hal_version_get_name_ptr());
+        if(cached) {
+            // before [NAME], so the server sends what changed instead of the whole canvas
+            char resume[32];
+            snprintf(resume, sizeof(resume), "[MAP/RESUME:%08lX]", (unsigned long)cached_hash);
+            flipper_http_send_data(fhttp, resume);
+        } else {
+            // the overview is one frame, ask for it first so there is something to show while the canvas loads
+            flipper_http_send_data(fhttp, OVERVIEW_REQUEST);
+        }
+
+        // with our link speed and view, so the server paces the canvas to the UART and sends what is on screen first
+        char name[48];
+        snprintf(name, sizeof(name), "[NAME:%d:%d]%s", LINK_RATE, state->camera.y, furi_hal_version_get_name_ptr());
         flipper_http_send_data(fhttp, name);
 
-        state->connected = 1; // Set connected to 1, connected to server but not yet loaded the canvas
+        // 1 is connected to the server but the canvas is not loaded yet, a cached one can be shown right away
+        state->connected = cached ? 2 : 1;
     }
 
     FuriThread* ws_thread = furi_thread_alloc();
@@ -435,17 +890,44 @@ int32_t painters_app(void* p) {
 
     InputEvent event;
 
-    while(furi_message_queue_get(queue, &event, FuriWaitForever) == FuriStatusOk) {
+    while(true) {
+        FuriStatus status = furi_message_queue_get(queue, &event, REPAIR_POLL_INTERVAL);
+        send_repair_requests(state);
+        if(status == FuriStatusErrorTimeout) continue;
+        if(status != FuriStatusOk) break;
+
         bool should_update = false;
 
-        if(event.type == InputTypeShort) {
-            if (state->connected == 2 && event.key != InputKeyBack) {
-                // send a [MAP/SYNC] every 10 minutes to the server
-                // to keep the connection alive and synchronize the map, only when input is received
+        if(event.type == InputTypeShort && state->zoom == ZoomOverview) {
+            // move a whole cell at a time, painting needs a real zoom level
+            switch(event.key) {
+            case InputKeyUp:
+                state->cursor.y -= OVERVIEW_CELL;
+                break;
+            case InputKeyDown:
+                state->cursor.y += OVERVIEW_CELL;
+                break;
+            case InputKeyLeft:
+                state->cursor.x -= OVERVIEW_CELL;
+                break;
+            case InputKeyRight:
+                state->cursor.x += OVERVIEW_CELL;
+                break;
+            case InputKeyBack:
+                flipper_http_websocket_stop(fhttp);
+                goto cleanup;
+            default:
+                break;
+            }
+            should_update = true;
+        } else if(event.type == InputTypeShort) {
+            if (state->connected == 2 && !state->syncing && event.key != InputKeyBack) {
+                // ask for the root hash every few minutes, to keep the connection alive and
+                // repair only the tiles that drifted, only when input is received
                 static uint32_t last_sync_time = 0;
                 uint32_t current_time = furi_get_tick();
                 if (current_time - last_sync_time > MAP_SYNC_INTERVAL) {
-                    flipper_http_send_data(fhttp, "[MAP/SYNC]");
+                    flipper_http_send_data(fhttp, "[MAP/HASH:]");
                     last_sync_time = current_time;
                 }
             }
@@ -466,7 +948,7 @@ int32_t painters_app(void* p) {
                 // check if pixel placement timeout is reached then you can paint again
                 uint32_t current_time = furi_get_tick();
                 if(state->pixel_place_timeout_start_time > 0 &&
-                   (current_time - state->pixel_place_timeout_start_time) < PIXEL_PLACE_TIMEOUT) {
+                   (current_time - state->pixel_place_timeout_start_time) < state->pixel_place_timeout) {
                     break; // Don't allow painting yet
                 }
 
@@ -484,6 +966,14 @@ int32_t painters_app(void* p) {
                     changed = true;
                 }
                 if(changed) {
+                    // remember the old color until the server acks or rejects the pixel
+                    furi_mutex_acquire(state->mutex, FuriWaitForever);
+                    state->pending_pixel.x = state->cursor.x;
+                    state->pending_pixel.y = state->cursor.y;
+                    state->pending_pixel.previous_color =
+                        !(state->painted_bytes[byte_index] & (1 << bit_index));
+                    state->pending_pixel.active = true;
+                    furi_mutex_release(state->mutex);
                     // set timeout for pixel placement
                     state->pixel_place_timeout_start_time = current_time;
                     // send pixel update to server
@@ -538,6 +1028,12 @@ cleanup:
     //if(state->connected) {
     flipper_http_websocket_stop(fhttp);
     //}
+
+    // Stop the thread first, it waits on the line queue and uses the mutex
+    furi_thread_flags_set(furi_thread_get_id(ws_thread), WorkerEvtStop);
+    furi_thread_join(ws_thread);
+    furi_thread_free(ws_thread);
+
     flipper_http_free(fhttp);
     gui_remove_view_port(gui, vp);
     view_port_free(vp);
@@ -546,17 +1042,13 @@ cleanup:
 
     furi_record_close(RECORD_GUI);
 
-    // Stop the thread
-    furi_thread_flags_set(furi_thread_get_id(ws_thread), WorkerEvtStop);
-    furi_thread_join(ws_thread);
-    furi_thread_free(ws_thread);
-
-    if(state->last_server_response) {
-        free(state->last_server_response);
+    // not a canvas a paced sync left half done
+    if(state->connected == 2 && !state->syncing) {
+        save_canvas_cache(state->painted_bytes);
     }
+
     free(state->painted_bytes);
     state->painted_bytes = NULL;
-    state->last_server_response = NULL;
     state->fhttp = NULL;
     state->vp = NULL;
     state->mutex = NULL;
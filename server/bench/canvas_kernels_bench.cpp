@@ -0,0 +1,127 @@
+// Benchmark of the canvas bit kernels, scalar and AVX2, against per-pixel loops, not part of the server build.
+//   g++ -std=c++23 -O2 canvas_kernels_bench.cpp ../core/canvas_kernels.cpp -o canvas_kernels_bench && ./canvas_kernels_bench
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../core/canvas_kernels.h"
+#include "../core/config.h"
+
+namespace {
+
+const size_t PIXELS = size_t(CANVAS_WIDTH) * CANVAS_HEIGHT;
+const size_t WORDS = (PIXELS + 63) / 64;
+const int ROUNDS = 200;
+
+// keeps the compiler from dropping the loops
+volatile size_t sink;
+
+template <typename Body>
+double timeUs(Body body) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; ++round) {
+        body();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / ROUNDS;
+}
+
+bool getBit(const uint64_t* words, size_t i) {
+    return (words[i / 64] >> (i % 64)) & 1;
+}
+
+void setBit(uint64_t* words, size_t i, bool value) {
+    words[i / 64] = value ? words[i / 64] | (1ull << (i % 64)) : words[i / 64] & ~(1ull << (i % 64));
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 rng(1);
+    std::vector<uint64_t> a(WORDS), b(WORDS), out(WORDS);
+    for (size_t i = 0; i < WORDS; ++i) {
+        a[i] = rng();
+        b[i] = rng();
+    }
+    const CanvasRect rect{13, 20, 333, 200}; // unaligned, not a multiple of 64 wide
+    std::vector<uint64_t> bitmap((rect.area() + 63) / 64);
+
+    std::printf("%-14s %12s %12s %12s\n", "kernel (us)", "per pixel", "scalar", "avx2");
+    auto row = [&](const char* name, auto per_pixel, auto kernel) {
+        double reference = timeUs(per_pixel);
+        double results[2] = {0, 0};
+        const char* names[2] = {"scalar", "avx2"};
+        for (int i = 0; i < 2; ++i) {
+            results[i] = kernels::setImplementation(names[i]) ? timeUs(kernel) : 0;
+        }
+        std::printf("%-14s %12.1f %12.1f %12.1f\n", name, reference, results[0], results[1]);
+    };
+
+    row("popcount",
+        [&] {
+            size_t total = 0;
+            for (size_t i = 0; i < PIXELS; ++i) {
+                total += getBit(a.data(), i);
+            }
+            sink = total;
+        },
+        [&] { sink = kernels::popcount(a.data(), WORDS); });
+    row("xorDiff",
+        [&] {
+            size_t total = 0;
+            for (size_t i = 0; i < PIXELS; ++i) {
+                bool diff = getBit(a.data(), i) != getBit(b.data(), i);
+                setBit(out.data(), i, diff);
+                total += diff;
+            }
+            sink = total;
+        },
+        [&] { sink = kernels::xorDiff(a.data(), b.data(), out.data(), WORDS); });
+    row("popcountRect",
+        [&] {
+            size_t total = 0;
+            for (int y = rect.y; y < rect.y + rect.height; ++y) {
+                for (int x = rect.x; x < rect.x + rect.width; ++x) {
+                    total += getBit(a.data(), size_t(y) * CANVAS_WIDTH + x);
+                }
+            }
+            sink = total;
+        },
+        [&] { sink = kernels::popcountRect(a.data(), rect); });
+    row("fillRect",
+        [&] {
+            for (int y = rect.y; y < rect.y + rect.height; ++y) {
+                for (int x = rect.x; x < rect.x + rect.width; ++x) {
+                    setBit(out.data(), size_t(y) * CANVAS_WIDTH + x, true);
+                }
+            }
+        },
+        [&] { kernels::fillRect(out.data(), rect, true); });
+    row("extractRect",
+        [&] {
+            size_t i = 0;
+            for (int y = rect.y; y < rect.y + rect.height; ++y) {
+                for (int x = rect.x; x < rect.x + rect.width; ++x) {
+                    setBit(bitmap.data(), i++, getBit(a.data(), size_t(y) * CANVAS_WIDTH + x));
+                }
+            }
+        },
+        [&] { kernels::extractRect(a.data(), rect, bitmap.data()); });
+    row("blitRect",
+        [&] {
+            size_t i = 0;
+            for (int y = rect.y; y < rect.y + rect.height; ++y) {
+                for (int x = rect.x; x < rect.x + rect.width; ++x) {
+                    if (getBit(b.data(), i)) {
+                        setBit(out.data(), size_t(y) * CANVAS_WIDTH + x, getBit(bitmap.data(), i));
+                    }
+                    i++;
+                }
+            }
+        },
+        [&] { kernels::blitRect(out.data(), rect, bitmap.data(), b.data()); });
+    std::printf("0 means the implementation is not available on this CPU\n");
+    return 0;
+}
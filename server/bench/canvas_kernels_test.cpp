@@ -0,0 +1,173 @@
+// Checks the canvas bit kernels against per-pixel reference loops, with the scalar and the AVX2
+// implementation, not part of the server build.
+//   g++ -std=c++23 -g -O1 -fsanitize=address,undefined canvas_kernels_test.cpp ../core/canvas_kernels.cpp -o canvas_kernels_test && ./canvas_kernels_test
+// It starts with PAINTERS_KERNELS=scalar set, so the runtime dispatch is checked with AVX2 forced off.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../core/canvas_kernels.h"
+#include "../core/config.h"
+
+namespace {
+
+const size_t PIXELS = size_t(CANVAS_WIDTH) * CANVAS_HEIGHT;
+const size_t WORDS = (PIXELS + 63) / 64; // the last word is partial
+
+int failures = 0;
+
+void expect(bool condition, const char* what, const CanvasRect& rect) {
+    if (!condition) {
+        std::printf("FAIL %s, rect %d,%d %dx%d\n", what, rect.x, rect.y, rect.width, rect.height);
+        failures++;
+    }
+}
+
+bool getBit(const uint64_t* words, size_t i) {
+    return (words[i / 64] >> (i % 64)) & 1;
+}
+
+void setBit(uint64_t* words, size_t i, bool value) {
+    words[i / 64] = value ? words[i / 64] | (1ull << (i % 64)) : words[i / 64] & ~(1ull << (i % 64));
+}
+
+size_t pixel(const CanvasRect& rect, size_t i) {
+    return size_t(rect.y + int(i / rect.width)) * CANVAS_WIDTH + rect.x + int(i % rect.width);
+}
+
+std::vector<uint64_t> randomWords(std::mt19937_64& rng, size_t count) {
+    std::vector<uint64_t> words(count);
+    for (auto& word : words) {
+        word = rng();
+    }
+    if (count == WORDS) {
+        words.back() &= (1ull << (PIXELS % 64)) - 1; // bits past the canvas stay clear
+    }
+    return words;
+}
+
+// Unaligned starts, widths around the word size, the edges and the last partial word
+std::vector<CanvasRect> testRects(std::mt19937_64& rng) {
+    std::vector<CanvasRect> rects = {
+        {0, 0, 1, 1},
+        {0, 0, CANVAS_WIDTH, CANVAS_HEIGHT},
+        {0, 7, CANVAS_WIDTH, 3},
+        {3, 5, 61, 2},
+        {1, 9, 63, 4},
+        {17, 2, 64, 3},
+        {63, 11, 65, 5},
+        {100, 100, 127, 7},
+        {CANVAS_WIDTH - 1, CANVAS_HEIGHT - 1, 1, 1},
+        {CANVAS_WIDTH - 70, CANVAS_HEIGHT - 3, 70, 3},
+        {0, CANVAS_HEIGHT - 1, CANVAS_WIDTH, 1},
+    };
+    for (int i = 0; i < 200; ++i) {
+        int width = 1 + int(rng() % CANVAS_WIDTH);
+        int height = 1 + int(rng() % 40);
+        rects.push_back({int(rng() % (CANVAS_WIDTH - width + 1)), int(rng() % (CANVAS_HEIGHT - height + 1)), width,
+                         height});
+    }
+    return rects;
+}
+
+void checkRects(std::mt19937_64& rng) {
+    for (const CanvasRect& rect : testRects(rng)) {
+        std::vector<uint64_t> canvas = randomWords(rng, WORDS);
+
+        for (bool color : {false, true}) {
+            std::vector<uint64_t> ours = canvas, reference = canvas;
+            kernels::fillRect(ours.data(), rect, color);
+            for (size_t i = 0; i < rect.area(); ++i) {
+                setBit(reference.data(), pixel(rect, i), color);
+            }
+            expect(ours == reference, color ? "fillRect" : "clearRect", rect);
+        }
+
+        size_t bitmap_words = (rect.area() + 63) / 64;
+        std::vector<uint64_t> bitmap = randomWords(rng, bitmap_words), mask = randomWords(rng, bitmap_words);
+        for (bool masked : {false, true}) {
+            std::vector<uint64_t> ours = canvas, reference = canvas;
+            kernels::blitRect(ours.data(), rect, bitmap.data(), masked ? mask.data() : nullptr);
+            for (size_t i = 0; i < rect.area(); ++i) {
+                if (!masked || getBit(mask.data(), i)) {
+                    setBit(reference.data(), pixel(rect, i), getBit(bitmap.data(), i));
+                }
+            }
+            expect(ours == reference, masked ? "blitRect with mask" : "blitRect", rect);
+        }
+
+        std::vector<uint64_t> extracted(bitmap_words, ~0ull), reference(bitmap_words, 0);
+        kernels::extractRect(canvas.data(), rect, extracted.data());
+        size_t painted = 0;
+        for (size_t i = 0; i < rect.area(); ++i) {
+            setBit(reference.data(), i, getBit(canvas.data(), pixel(rect, i)));
+            painted += getBit(canvas.data(), pixel(rect, i));
+        }
+        expect(extracted == reference, "extractRect", rect);
+        expect(kernels::popcountRect(canvas.data(), rect) == painted, "popcountRect", rect);
+    }
+}
+
+void checkBuffers(std::mt19937_64& rng) {
+    const CanvasRect whole{0, 0, CANVAS_WIDTH, CANVAS_HEIGHT};
+    // every count around the 4 word AVX2 step, and the whole canvas
+    std::vector<size_t> counts = {WORDS};
+    for (size_t count = 0; count <= 13; ++count) {
+        counts.push_back(count);
+    }
+    for (size_t count : counts) {
+        std::vector<uint64_t> a = randomWords(rng, count), b = randomWords(rng, count);
+        size_t set = 0, differing = 0;
+        std::vector<uint64_t> reference(count);
+        for (size_t i = 0; i < count * 64; ++i) {
+            set += getBit(a.data(), i);
+            differing += getBit(a.data(), i) != getBit(b.data(), i);
+            setBit(reference.data(), i, getBit(a.data(), i) != getBit(b.data(), i));
+        }
+        std::vector<uint64_t> out(count, 0);
+        expect(kernels::popcount(a.data(), count) == set, "popcount", whole);
+        expect(kernels::xorDiff(a.data(), b.data(), out.data(), count) == differing, "xorDiff count", whole);
+        expect(out == reference, "xorDiff", whole);
+        expect(kernels::xorDiff(a.data(), b.data(), nullptr, count) == differing, "xorDiff without out", whole);
+        // unaligned range, both partial end words
+        if (count >= 2) {
+            size_t start = 5, end = count * 64 - 3, in_range = 0;
+            for (size_t i = start; i < end; ++i) {
+                in_range += getBit(a.data(), i);
+            }
+            expect(kernels::popcountBits(a.data(), start, end) == in_range, "popcountBits", whole);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    setenv("PAINTERS_KERNELS", "scalar", 1);
+    if (std::strcmp(kernels::implementation(), "scalar") != 0) {
+        std::printf("FAIL PAINTERS_KERNELS=scalar picked %s\n", kernels::implementation());
+        failures++;
+    }
+
+    for (const char* name : {"scalar", "avx2"}) {
+        if (!kernels::setImplementation(name)) {
+            std::printf("%s not available on this CPU, skipped\n", name);
+            continue;
+        }
+        std::mt19937_64 rng(1);
+        checkRects(rng);
+        checkBuffers(rng);
+        std::printf("%s checked\n", kernels::implementation());
+    }
+    expect(!kernels::setImplementation("neon"), "setImplementation accepted an unknown name", {});
+
+    if (failures) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Benchmark of parsePixel against the stoul parsing it replaced, not part of the server build.
+//   g++ -std=c++23 -O2 pixel_parser_bench.cpp ../core/pixel_parser.cpp -o pixel_parser_bench && ./pixel_parser_bench
+// Parses a mix of valid and malformed [PIXEL] payloads with both and checks they agree on the valid ones.
+
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../core/pixel_parser.h"
+
+namespace {
+
+const int ROUNDS = 50;
+
+// The previous handlePixel code, exceptions caught so malformed payloads don't end the benchmark
+std::optional<PixelUpdate> parseStoul(std::string_view pixel_data) {
+    auto x_pos = pixel_data.find("x:");
+    auto y_pos = pixel_data.find(",y:");
+    auto c_pos = pixel_data.find(",c:");
+    if (x_pos != 0 || y_pos == std::string_view::npos || c_pos == std::string_view::npos) {
+        return std::nullopt;
+    }
+    try {
+        auto x = std::stoul(std::string(pixel_data.substr(2, y_pos - 2)));
+        auto y = std::stoul(std::string(pixel_data.substr(y_pos + 3, c_pos - (y_pos + 3))));
+        auto color = std::stoul(std::string(pixel_data.substr(c_pos + 3)));
+        if (x >= CANVAS_WIDTH || y >= CANVAS_HEIGHT || color > 1) {
+            return std::nullopt;
+        }
+        return PixelUpdate{uint16_t(x), uint16_t(y), color == 1};
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+template <typename Parse>
+double timeMs(const std::vector<std::string>& payloads, size_t& accepted, Parse parse) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; ++round) {
+        accepted = 0;
+        for (const std::string& payload : payloads) {
+            accepted += parse(payload);
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / ROUNDS;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(1);
+    std::vector<std::string> payloads;
+    for (int i = 0; i < 100000; ++i) {
+        payloads.push_back("x:" + std::to_string(rng() % CANVAS_WIDTH) + ",y:" + std::to_string(rng() % CANVAS_HEIGHT) +
+                           ",c:" + std::to_string(rng() % 2));
+    }
+    // one in ten is garbage, the old parser threw on these
+    for (int i = 0; i < 10000; ++i) {
+        payloads.push_back(i % 2 ? "x:,y:1,c:1" : "x:12,y:abc,c:1");
+    }
+
+    int mismatches = 0;
+    for (const std::string& payload : payloads) {
+        auto ours = parsePixel(payload);
+        auto old = parseStoul(payload);
+        if (ours.has_value() != old.has_value() ||
+            (ours && (ours->x != old->x || ours->y != old->y || ours->color != old->color))) {
+            mismatches++;
+        }
+    }
+
+    size_t accepted_old = 0, accepted_new = 0;
+    double stoul_ms = timeMs(payloads, accepted_old, [](std::string_view p) { return parseStoul(p).has_value(); });
+    double from_chars_ms = timeMs(payloads, accepted_new, [](std::string_view p) { return parsePixel(p).has_value(); });
+
+    std::printf("%zu payloads, %zu valid: stoul %.2f ms, from_chars %.2f ms (%.1fx)\n", payloads.size(), accepted_new,
+                stoul_ms, from_chars_ms, stoul_ms / from_chars_ms);
+    if (mismatches || accepted_old != accepted_new) {
+        std::printf("FAIL %d payloads parsed differently\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
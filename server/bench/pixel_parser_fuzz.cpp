@@ -0,0 +1,117 @@
+// libFuzzer target for the [PIXEL] and [PIXELS] payload parsers, not part of the server build.
+//   clang++ -std=c++23 -g -O1 -fsanitize=fuzzer,address,undefined pixel_parser_fuzz.cpp ../core/pixel_parser.cpp
+//   ./a.out -max_len=160
+// Without libFuzzer, -DFUZZ_MAIN adds a driver that checks the known bad frames and feeds random mutations of them:
+//   g++ -std=c++23 -g -O1 -fsanitize=address,undefined -DFUZZ_MAIN pixel_parser_fuzz.cpp ../core/pixel_parser.cpp
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "../core/pixel_parser.h"
+
+namespace {
+
+void check(bool condition, const char* what, std::string_view payload) {
+    if (!condition) {
+        std::fprintf(stderr, "%s: \"%.*s\"\n", what, int(payload.size()), payload.data());
+        std::abort();
+    }
+}
+
+// Whatever parses has to be on the canvas, and print back to a payload that parses the same
+void checkPixel(std::string_view payload) {
+    auto pixel = parsePixel(payload);
+    if (!pixel) {
+        return;
+    }
+    check(pixel->x < CANVAS_WIDTH && pixel->y < CANVAS_HEIGHT, "pixel outside the canvas", payload);
+    std::string printed = "x:" + std::to_string(pixel->x) + ",y:" + std::to_string(pixel->y) +
+        ",c:" + std::to_string(int(pixel->color));
+    auto again = parsePixel(printed);
+    check(again && again->x == pixel->x && again->y == pixel->y && again->color == pixel->color,
+          "pixel doesn't round trip", payload);
+}
+
+void checkBatch(std::string_view payload) {
+    auto batch = parsePixelBatch(payload);
+    if (!batch) {
+        return;
+    }
+    check(batch->pixelCount() > 0, "empty batch", payload);
+    if (batch->shape == BatchShape::List) {
+        check(batch->count <= MAX_BATCH_POINTS, "too many points", payload);
+        for (uint8_t i = 0; i < batch->count; ++i) {
+            check(batch->points[i].x < CANVAS_WIDTH && batch->points[i].y < CANVAS_HEIGHT, "point outside the canvas",
+                  payload);
+        }
+    } else {
+        check(batch->width > 0 && batch->height > 0 && batch->x + batch->width <= CANVAS_WIDTH &&
+                  batch->y + batch->height <= CANVAS_HEIGHT,
+              "shape outside the canvas", payload);
+        check(batch->shape == BatchShape::Rect || batch->height == 1, "run taller than a row", payload);
+    }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string_view payload(reinterpret_cast<const char*>(data), size);
+    checkPixel(payload);
+    checkBatch(payload);
+    return 0;
+}
+
+#ifdef FUZZ_MAIN
+int main(int argc, char** argv) {
+    // frames that threw out of stoul or wrapped around before from_chars
+    const char* rejected[] = {
+        "x:,y:1,c:1", "x:1,y:,c:1", "x:1,y:1,c:", "x:-1,y:1,c:1", "x:1,y:-1,c:1", "x:1,y:1,c:-1",
+        "x:4294967295,y:1,c:1", "x:4294967796,y:1,c:1", "x:18446744073709551616,y:1,c:1", "x:+1,y:1,c:1",
+        "x: 1,y:1,c:1", "x:1,y:1,c:1 ", "x:500,y:1,c:1", "x:1,y:500,c:1", "x:1,y:1,c:2", "x:0x1,y:1,c:1",
+    };
+    for (const char* payload : rejected) {
+        check(!parsePixel(payload), "accepted a bad pixel", payload);
+    }
+    const char* rejected_batches[] = {
+        "r:-1,0,10,1", "r:499,0,2,1", "r:0,0,0,1", "b:0,0,4294967295,1,1", "b:1,1,500,1,1", "l:1:", "l:1",
+        "l:1:1,1;", "l:1:,1", "l:2:1,1", "x:1,y:1,c:1", "l:1:1,1;1,1;1,1;1,1;1,1;1,1;1,1;1,1;1,1;1,1;1,1;1,1;1,1;"
+        "1,1;1,1;1,1;1,1",
+    };
+    for (const char* payload : rejected_batches) {
+        check(!parsePixelBatch(payload), "accepted a bad batch", payload);
+    }
+    check(parsePixel("x:499,y:499,c:1").has_value(), "rejected a good pixel", "x:499,y:499,c:1");
+    check(parsePixelBatch("b:0,0,500,500,0").has_value(), "rejected a good batch", "b:0,0,500,500,0");
+
+    // random byte flips, inserts and cuts of good and bad frames
+    const char* seeds[] = {"x:12,y:345,c:1", "r:10,20,30,0", "b:0,0,500,500,1", "l:1:1,2;3,4;5,6", "x:,y:1,c:1"};
+    const char alphabet[] = "0123456789:,;-+xyclrb ";
+    long rounds = argc > 1 ? std::atol(argv[1]) : 1000000;
+    std::srand(1);
+    for (long round = 0; round < rounds; ++round) {
+        std::string input = seeds[round % std::size(seeds)];
+        for (int edits = 1 + std::rand() % 4; edits > 0; --edits) {
+            size_t at = std::rand() % (input.size() + 1);
+            char c = std::rand() % 8 ? alphabet[std::rand() % (sizeof(alphabet) - 1)] : char(std::rand());
+            switch (std::rand() % 3) {
+            case 0:
+                input.insert(at, 1, c);
+                break;
+            case 1:
+                if (at < input.size()) input[at] = c;
+                break;
+            case 2:
+                input.erase(at, 1 + std::rand() % 3);
+                break;
+            }
+        }
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    }
+    std::printf("%zu bad frames rejected, %ld mutations checked\n", std::size(rejected) + std::size(rejected_batches),
+                rounds);
+    return 0;
+}
+#endif
@@ -0,0 +1,378 @@
+// Drives ServerCore through MemoryTransport the way a Flipper would and checks the replies, not
+// part of the server build.
+//   g++ -std=c++23 -g -O1 -fsanitize=address,undefined -I../core server_core_test.cpp ../core/server_core.cpp ../core/memory_transport.cpp ../core/admission.cpp ../core/adaptive_cooldown.cpp ../core/attribution.cpp ../core/canvas.cpp ../core/canvas_hash_tree.cpp ../core/canvas_kernels.cpp ../core/canvas_pyramid.cpp ../core/pixel_parser.cpp ../core/placement_history.cpp ../core/png.cpp ../core/rate_limiter.cpp ../core/sync_plan.cpp -lz -o server_core_test && ./server_core_test
+// The core logs to std::cout, which is silenced, results go to stdout with printf.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../core/memory_transport.h"
+#include "../core/server_core.h"
+
+namespace {
+
+int failures = 0;
+
+void expect(bool condition, const char* what) {
+    if (!condition) {
+        std::printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// Simulated time, so cooldowns and budgets refill without waiting
+ServerCore::Clock::time_point now = ServerCore::Clock::time_point(std::chrono::hours(1));
+
+ServerCore::Clock::time_point simulatedNow() {
+    return now;
+}
+
+void advance(uint32_t milliseconds) {
+    now += std::chrono::milliseconds(milliseconds);
+}
+
+bool startsWith(std::string_view message, std::string_view prefix) {
+    return message.substr(0, prefix.size()) == prefix;
+}
+
+size_t countPrefix(const MemoryConnection* connection, std::string_view prefix) {
+    size_t count = 0;
+    for (const std::string& message : connection->outbox) {
+        count += startsWith(message, prefix);
+    }
+    return count;
+}
+
+uint8_t hexByte(std::string_view hex) {
+    auto digit = [](char c) { return c <= '9' ? c - '0' : c - 'A' + 10; };
+    return uint8_t(digit(hex[0]) << 4 | digit(hex[1]));
+}
+
+// What the Flipper keeps of the canvas, built from the frames the server sends
+struct ClientCanvas {
+    Canvas canvas;
+    bool ended = false;
+    size_t view_ends = 0;
+
+    void apply(std::string_view message) {
+        if (message == "[MAP/CLEAR]") {
+            std::memset(canvas.bytes(), 0, canvas.size());
+        } else if (message == "[MAP/END]") {
+            ended = true;
+        } else if (message == "[MAP/VIEW/END]") {
+            view_ends++;
+        } else if (startsWith(message, "[MAP/CHUNK:")) {
+            size_t colon = message.find(':', 11), close = message.find(']');
+            size_t start = std::stoul(std::string(message.substr(colon + 1, close - colon - 1)));
+            for (size_t i = close + 1; i + 1 < message.size(); i += 2) {
+                canvas.bytes()[start++] = hexByte(message.substr(i, 2));
+            }
+        } else if (startsWith(message, "[PIXEL]")) {
+            int x = 0, y = 0, color = 0;
+            std::sscanf(std::string(message).c_str(), "[PIXEL]x:%d,y:%d,c:%d", &x, &y, &color);
+            canvas.setPixel(x, y, color);
+        }
+    }
+
+    void applyAll(MemoryConnection* connection) {
+        for (const std::string& message : connection->outbox) {
+            apply(message);
+        }
+        connection->outbox.clear();
+    }
+
+    bool matches(const Canvas& other) const {
+        return std::memcmp(canvas.bytes(), other.bytes(), canvas.size()) == 0;
+    }
+};
+
+void paintRandom(Canvas& canvas, uint32_t seed, int pixels) {
+    std::mt19937 rng(seed);
+    for (int i = 0; i < pixels; ++i) {
+        canvas.setPixel(rng() % CANVAS_WIDTH, rng() % CANVAS_HEIGHT, true);
+    }
+}
+
+// [WAKE] on connect, then [NAME] sends the whole canvas
+void checkNameSync() {
+    Canvas canvas;
+    paintRandom(canvas, 1, 5000);
+    ServerCore core(canvas);
+    core.setTimeSource(simulatedNow);
+    MemoryTransport transport(core);
+
+    MemoryConnection* client = transport.connect("10.0.0.1");
+    expect(client && client->outbox.size() == 1 && startsWith(client->outbox[0], "[WAKE:cw:500:ch:500:"), "wake");
+    client->outbox.clear();
+
+    client->receive("[NAME]  alice  ");
+    expect(getClientName(client) == "alice", "name trimmed");
+    expect(client->outbox.front() == "[MAP/SEND]", "sync starts");
+    for (const std::string& message : client->outbox) {
+        expect(message.size() <= size_t(MAX_PAYLOAD_SIZE), "chunk fits the payload size");
+    }
+    ClientCanvas copy;
+    copy.applyAll(client);
+    expect(copy.ended && copy.matches(canvas), "named client gets the canvas");
+}
+
+// [PIXEL] is acknowledged, broadcast and held to the cooldown per address
+void checkPixel() {
+    Canvas canvas;
+    ServerCore core(canvas);
+    core.setTimeSource(simulatedNow);
+    core.log_pixels = false;
+    MemoryTransport transport(core);
+    MemoryConnection* painter = transport.connect("10.0.0.2");
+    MemoryConnection* watcher = transport.connect("10.0.0.3");
+    painter->outbox.clear();
+    watcher->outbox.clear();
+
+    painter->receive("[PIXEL]x:3,y:4,c:1");
+    expect(canvas.getPixel(3, 4), "pixel placed");
+    expect(painter->outbox.size() == 2 &&
+           painter->outbox[0] == "[PIXEL/ACK:3:4:" + std::to_string(canvas.version()) + "]", "pixel acknowledged");
+    expect(watcher->outbox.size() == 1 && watcher->outbox[0] == "[PIXEL]x:3,y:4,c:1", "pixel broadcast");
+    painter->outbox.clear();
+    watcher->outbox.clear();
+
+    // a second connection from the same address shares the cooldown
+    MemoryConnection* again = transport.connect("10.0.0.2");
+    again->outbox.clear();
+    again->receive("[PIXEL]x:3,y:5,c:1");
+    expect(!canvas.getPixel(3, 5), "pixel within the cooldown not placed");
+    expect(again->outbox.size() == 1 && startsWith(again->outbox[0], "[PIXEL/REJECT:3:5:"), "pixel rejected");
+    expect(watcher->outbox.empty(), "rejected pixel not broadcast");
+
+    advance(PIXEL_PLACE_TIMEOUT);
+    again->receive("[PIXEL]x:3,y:5,c:1");
+    expect(canvas.getPixel(3, 5) && countPrefix(again, "[PIXEL/ACK:3:5:") == 1, "pixel after the cooldown");
+
+    // malformed and off canvas pixels are dropped without a reply
+    watcher->outbox.clear();
+    advance(PIXEL_PLACE_TIMEOUT);
+    watcher->receive("[PIXEL]x:,y:1,c:1");
+    watcher->receive("[PIXEL]x:500,y:1,c:1");
+    expect(watcher->outbox.empty(), "bad pixels ignored");
+}
+
+// [MAP/SYNC] takes from the sync budget and is answered with [MAP/RETRY] once it is spent
+void checkSyncBudget() {
+    Canvas canvas;
+    ServerCore core(canvas);
+    core.setTimeSource(simulatedNow);
+    MemoryTransport transport(core);
+    MemoryConnection* client = transport.connect("10.0.0.4");
+    client->receive("[NAME]bob"); // the first sync
+    client->outbox.clear();
+
+    for (int i = 1; i < SYNC_BURST; ++i) {
+        client->receive("[MAP/SYNC]");
+    }
+    expect(countPrefix(client, "[MAP/END]") == SYNC_BURST - 1, "syncs within the burst");
+    client->outbox.clear();
+
+    client->receive("[MAP/SYNC]");
+    expect(client->outbox.size() == 1 && startsWith(client->outbox[0], "[MAP/RETRY:"), "sync refused");
+    uint32_t seconds = uint32_t(std::stoul(client->outbox[0].substr(11)));
+    expect(seconds * 1000 >= SYNC_REFILL_INTERVAL && seconds * 1000 < SYNC_REFILL_INTERVAL + 2000, "retry time");
+    client->outbox.clear();
+
+    advance(seconds * 1000);
+    client->receive("[MAP/SYNC]");
+    expect(countPrefix(client, "[MAP/END]") == 1, "sync at the retry time");
+}
+
+// A client that missed some placements walks the hash tree down to the tiles that differ
+void checkHashWalk() {
+    Canvas canvas;
+    paintRandom(canvas, 2, 20000);
+    ServerCore core(canvas);
+    core.setTimeSource(simulatedNow);
+    MemoryTransport transport(core);
+    MemoryConnection* client = transport.connect("10.0.0.5");
+    client->receive("[NAME]carol");
+    ClientCanvas copy;
+    copy.applyAll(client);
+
+    // changes the client never heard about, in three tiles
+    canvas.setPixel(0, 0, !canvas.getPixel(0, 0));
+    canvas.fillRect(100, 100, 10, 10, true);
+    canvas.setPixel(CANVAS_WIDTH - 1, CANVAS_HEIGHT - 1, !canvas.getPixel(CANVAS_WIDTH - 1, CANVAS_HEIGHT - 1));
+
+    CanvasHashTree mine;
+    mine.update(copy.canvas);
+    std::vector<std::string> paths = {""};
+    size_t hashes = 0, tiles = 0;
+    while (!paths.empty()) {
+        std::string path = paths.back();
+        paths.pop_back();
+        client->receive("[MAP/HASH:" + path + "]");
+        expect(client->outbox.size() == 1, "one hash frame");
+        std::string reply = client->outbox.back();
+        std::string prefix = "[MAP/HASH:" + path + "]";
+        expect(startsWith(reply, prefix) && reply.size() == prefix.size() + 8 + 4 * 9, "hash frame layout");
+        hashes++;
+
+        CanvasHashTree::Node node = *CanvasHashTree::parsePath(path);
+        for (int quadrant = 0; quadrant < 4; ++quadrant) {
+            CanvasHashTree::Node child{node.depth + 1, node.x * 2 + (quadrant & 1), node.y * 2 + (quadrant >> 1)};
+            uint32_t theirs = uint32_t(std::stoul(std::string(reply.substr(prefix.size() + 9 + quadrant * 9, 8)), nullptr, 16));
+            if (theirs == mine.hash(child)) {
+                continue;
+            }
+            std::string child_path = path + char('0' + quadrant);
+            if (child.depth < CanvasHashTree::DEPTH) {
+                paths.push_back(child_path);
+                continue;
+            }
+            client->outbox.clear();
+            client->receive("[MAP/TILE:" + child_path + "]");
+            CanvasHashTree::TileRect rect = CanvasHashTree::tileRect(child.x, child.y);
+            std::string header = "[MAP/TILE:" + child_path + ":" + std::to_string(rect.x) + ":" +
+                std::to_string(rect.y) + ":" + std::to_string(rect.width) + ":" + std::to_string(rect.height) + "]";
+            std::string tile = client->outbox.back();
+            size_t row_bytes = (rect.width + 7) / 8;
+            expect(startsWith(tile, header) && tile.size() == header.size() + row_bytes * rect.height * 2, "tile frame");
+            for (int row = 0; row < rect.height; ++row) {
+                for (int column = 0; column < rect.width; ++column) {
+                    uint8_t byte = hexByte(tile.substr(header.size() + (row * row_bytes + column / 8) * 2, 2));
+                    copy.canvas.setPixel(rect.x + column, rect.y + row, (byte >> (column % 8)) & 1);
+                }
+            }
+            tiles++;
+        }
+        client->outbox.clear();
+    }
+    expect(copy.matches(canvas), "repaired canvas");
+    expect(tiles == 3, "only the changed tiles fetched");
+    expect(hashes <= 1 + 3 * (CanvasHashTree::DEPTH - 1), "hash walk stays narrow");
+
+    // a hash walk on an up to date canvas stops at the root
+    client->receive("[MAP/RESUME:" + [&] {
+        char hex[9];
+        std::snprintf(hex, sizeof(hex), "%08X", core.hashTree().root());
+        return std::string(hex);
+    }() + "]");
+    expect(client->outbox.size() == 1 && client->outbox[0] == "[MAP/END]", "resume up to date");
+    client->outbox.clear();
+
+    // the repair budget is REPAIR_BURST tiles, after that the client is told to wait
+    size_t served = 0;
+    for (int i = 0; i < 2 * REPAIR_BURST; ++i) {
+        client->receive("[MAP/TILE:0000]");
+    }
+    served = countPrefix(client, "[MAP/TILE:");
+    expect(served < size_t(REPAIR_BURST) && served + countPrefix(client, "[MAP/RETRY:") == 2 * REPAIR_BURST,
+           "tiles refused once the repair budget is spent");
+}
+
+// [MAP/OVERVIEW] pays for its size in tiles from the repair budget
+void checkOverview() {
+    Canvas canvas;
+    paintRandom(canvas, 4, 20000);
+    ServerCore core(canvas);
+    core.setTimeSource(simulatedNow);
+    MemoryTransport transport(core);
+    MemoryConnection* client = transport.connect("10.0.0.8");
+    client->outbox.clear();
+
+    CanvasPyramid& pyramid = core.pyramid();
+    const int level = MIN_OVERVIEW_LEVEL;
+    std::string header = "[MAP/OVERVIEW:" + std::to_string(level) + ":" + std::to_string(pyramid.width(level)) + ":" +
+        std::to_string(pyramid.height(level)) + "]";
+    client->receive("[MAP/OVERVIEW:" + std::to_string(level) + "]");
+    expect(client->outbox.size() == 1 && startsWith(client->outbox[0], header) &&
+           client->outbox[0].size() == header.size() + pyramid.overviewSize(level) * 2, "overview frame");
+    client->outbox.clear();
+
+    size_t tile_bytes = CanvasHashTree::TILE_SIZE * CanvasHashTree::TILE_SIZE / 8;
+    size_t affordable = REPAIR_BURST * tile_bytes / pyramid.overviewSize(level);
+    for (size_t i = 1; i < 2 * affordable; ++i) {
+        client->receive("[MAP/OVERVIEW:" + std::to_string(level) + "]");
+    }
+    expect(countPrefix(client, "[MAP/OVERVIEW:") == affordable - 1, "overviews within the repair budget");
+    expect(countPrefix(client, "[MAP/RETRY:") == affordable, "overviews refused once it is spent");
+}
+
+// A client on a slow link gets its view first, then the rest paced per tick
+void checkPacedSync() {
+    Canvas canvas;
+    paintRandom(canvas, 3, 8000);
+    ServerCore core(canvas);
+    core.setTimeSource(simulatedNow);
+    MemoryTransport transport(core);
+    MemoryConnection* slow = transport.connect("10.0.0.6");
+    slow->outbox.clear();
+
+    const uint32_t rate = 4000;
+    slow->receive("[NAME:" + std::to_string(rate) + ":200]dave");
+    expect(slow->outbox.front() == "[MAP/CLEAR]", "paced sync clears first");
+    ClientCanvas copy;
+    int ticks = 0;
+    bool view_checked = false;
+    while (!copy.ended && ticks < 200) {
+        size_t bytes = 0;
+        for (const std::string& message : slow->outbox) {
+            bytes += message.size();
+            copy.apply(message);
+            if (message == "[MAP/VIEW/END]") {
+                size_t view = size_t(200) * CANVAS_WIDTH / 8;
+                view_checked = std::memcmp(copy.canvas.bytes() + view, canvas.bytes() + view,
+                                           size_t(SYNC_VIEW_ROWS) * CANVAS_WIDTH / 8) == 0;
+            }
+        }
+        slow->outbox.clear();
+        expect(bytes <= rate * LOAD_SAMPLE_INTERVAL / 1000 + MAX_PAYLOAD_SIZE, "paced to the link");
+        if (!copy.ended) {
+            advance(LOAD_SAMPLE_INTERVAL);
+            core.tick();
+            ticks++;
+        }
+    }
+    expect(ticks > 1, "sync spread over ticks");
+    expect(copy.ended && copy.matches(canvas), "paced sync complete");
+    expect(copy.view_ends == 1 && view_checked, "view rows arrive first");
+}
+
+// Connections over MAX_CLIENTS_PER_ADDRESS are refused until one closes
+void checkAdmission() {
+    Canvas canvas;
+    ServerCore core(canvas);
+    core.setTimeSource(simulatedNow);
+    MemoryTransport transport(core);
+    std::vector<MemoryConnection*> connections;
+    for (int i = 0; i < MAX_CLIENTS_PER_ADDRESS; ++i) {
+        connections.push_back(transport.connect("10.0.0.7"));
+        expect(connections.back() != nullptr, "connection admitted");
+    }
+    expect(transport.connect("10.0.0.7") == nullptr, "connection over the address limit refused");
+    expect(core.clientCount() == size_t(MAX_CLIENTS_PER_ADDRESS), "refused connection not counted");
+    transport.disconnect(connections.front());
+    expect(transport.connect("10.0.0.7") != nullptr, "admitted after a close");
+}
+
+} // namespace
+
+int main() {
+    std::cout.setstate(std::ios::failbit);
+    checkNameSync();
+    checkPixel();
+    checkSyncBudget();
+    checkHashWalk();
+    checkOverview();
+    checkPacedSync();
+    checkAdmission();
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("server core checked\n");
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include "adaptive_cooldown.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "config.h"
+
+AdaptiveCooldown::AdaptiveCooldown(uint32_t min_ms, uint32_t max_ms)
+    : min_ms_(min_ms), max_ms_(std::max(min_ms, max_ms)), timeout_ms_(min_ms), announced_ms_(min_ms) {}
+
+bool AdaptiveCooldown::update(size_t queued_bytes, uint32_t loop_lag_ms) {
+    double sample = std::max(double(queued_bytes) / BROADCAST_QUEUE_HIGH, double(loop_lag_ms) / LOOP_LAG_HIGH);
+    // react quickly to rising load, relax slowly
+    double weight = sample > pressure_ ? 0.5 : 0.2;
+    pressure_ += (sample - pressure_) * weight;
+
+    double next = timeout_ms_;
+    if (pressure_ > 1.0) {
+        next *= 1.5;
+    } else if (pressure_ < 0.5) {
+        next *= 0.9;
+    }
+    timeout_ms_ = uint32_t(std::clamp(next, double(min_ms_), double(max_ms_)));
+
+    // only announce changes of at least 10%, or reaching a bound, to keep the chatter down
+    uint32_t change = uint32_t(std::abs(int64_t(timeout_ms_) - int64_t(announced_ms_)));
+    bool at_bound = timeout_ms_ == min_ms_ || timeout_ms_ == max_ms_;
+    if (change * 10 >= announced_ms_ || (at_bound && change > 0)) {
+        announced_ms_ = timeout_ms_;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Scales the pixel cooldown with server load: raised when the broadcast queues
+// grow or the event loop lags behind, lowered again when the pressure is gone.
+class AdaptiveCooldown {
+public:
+    AdaptiveCooldown(uint32_t min_ms, uint32_t max_ms);
+
+    // Feed one load sample, returns true when the timeout moved enough to announce it
+    bool update(size_t queued_bytes, uint32_t loop_lag_ms);
+
+    uint32_t timeout() const { return timeout_ms_; }
+
+private:
+    uint32_t min_ms_;
+    uint32_t max_ms_;
+    uint32_t timeout_ms_;
+    uint32_t announced_ms_;
+    double pressure_ = 0; // smoothed, 1.0 means at the configured high water mark
+};
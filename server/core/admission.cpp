@@ -0,0 +1,66 @@
+#include "admission.h"
+
+#include "config.h"
+
+// Upper bound on remembered named addresses, expired ones are dropped first
+const size_t MAX_NAMED_ADDRESSES = 4096;
+
+const char* describeAdmission(Admission admission) {
+    switch (admission) {
+    case Admission::Accepted:
+        return "accepted";
+    case Admission::ServerFull:
+        return "max clients reached";
+    case Admission::TooManyFromAddress:
+        return "too many connections from this address";
+    }
+    return "unknown";
+}
+
+Admission AdmissionControl::check(const std::string& address, Clock::time_point now) const {
+    auto it = per_address_.find(address);
+    if (it != per_address_.end() && it->second >= MAX_CLIENTS_PER_ADDRESS) {
+        return Admission::TooManyFromAddress;
+    }
+
+    if (connected_ < MAX_CLIENTS - RESERVED_CLIENT_SLOTS) {
+        return Admission::Accepted;
+    }
+    if (connected_ < MAX_CLIENTS) {
+        auto named = named_until_.find(address);
+        if (named != named_until_.end() && named->second > now) {
+            return Admission::Accepted;
+        }
+    }
+    return Admission::ServerFull;
+}
+
+void AdmissionControl::add(const std::string& address) {
+    per_address_[address]++;
+    connected_++;
+}
+
+void AdmissionControl::release(const std::string& address) {
+    auto it = per_address_.find(address);
+    if (it == per_address_.end()) {
+        return;
+    }
+    if (--it->second == 0) {
+        per_address_.erase(it);
+    }
+    connected_--;
+}
+
+void AdmissionControl::rememberNamed(const std::string& address, Clock::time_point now) {
+    if (named_until_.size() >= MAX_NAMED_ADDRESSES) {
+        forgetExpired(now);
+        if (named_until_.size() >= MAX_NAMED_ADDRESSES && !named_until_.contains(address)) {
+            return;
+        }
+    }
+    named_until_[address] = now + std::chrono::seconds(NAMED_CLIENT_MEMORY);
+}
+
+void AdmissionControl::forgetExpired(Clock::time_point now) {
+    std::erase_if(named_until_, [now](const auto& entry) { return entry.second <= now; });
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+enum class Admission : uint8_t {
+    Accepted,
+    ServerFull,
+    TooManyFromAddress,
+};
+
+const char* describeAdmission(Admission admission);
+
+// Decides whether a new connection may join, before any WebSocket state exists.
+// The last RESERVED_CLIENT_SLOTS are only handed to addresses that recently set a name.
+class AdmissionControl {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Admission check(const std::string& address, Clock::time_point now) const;
+    void add(const std::string& address);
+    void release(const std::string& address);
+
+    // Remember an address that identified itself, so it can use the reserved pool
+    void rememberNamed(const std::string& address, Clock::time_point now);
+
+    size_t connected() const { return connected_; }
+
+private:
+    void forgetExpired(Clock::time_point now);
+
+    std::unordered_map<std::string, uint32_t> per_address_;
+    std::unordered_map<std::string, Clock::time_point> named_until_;
+    size_t connected_ = 0;
+};
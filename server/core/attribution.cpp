@@ -0,0 +1,98 @@
+#include "attribution.h"
+
+#include <algorithm>
+
+// Reserving UNKNOWN_ID keeps it out of the lookup, no client string maps to it
+Interner::Interner() : texts_{""} {}
+
+InternId Interner::intern(std::string_view text) {
+    if (text.empty()) {
+        return UNKNOWN_ID;
+    }
+    auto it = ids_.find(std::string(text));
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    if (texts_.size() > UINT16_MAX) {
+        return UNKNOWN_ID;
+    }
+    InternId id = InternId(texts_.size());
+    texts_.emplace_back(text);
+    ids_.emplace(texts_.back(), id);
+    return id;
+}
+
+InternId Interner::reserve(std::string_view label) {
+    if (texts_.size() > UINT16_MAX) {
+        return UNKNOWN_ID;
+    }
+    texts_.emplace_back(label);
+    return InternId(texts_.size() - 1);
+}
+
+InternId Interner::find(std::string_view text) const {
+    auto it = ids_.find(std::string(text));
+    return it == ids_.end() ? UNKNOWN_ID : it->second;
+}
+
+const std::string& Interner::text(InternId id) const {
+    return id < texts_.size() ? texts_[id] : texts_[UNKNOWN_ID];
+}
+
+AttributionPlane::AttributionPlane() : owners_(size_t(TILES_X) * TILES_Y * TILE * TILE) {}
+
+template <typename Owner, typename Fn>
+void AttributionPlane::forEachInRect(Owner* owners, const CanvasRect& rect, Fn&& fn) {
+    int x_end = rect.x + rect.width;
+    int y_end = rect.y + rect.height;
+    for (int ty = rect.y >> TILE_SHIFT; ty <= (y_end - 1) >> TILE_SHIFT; ++ty) {
+        int y0 = std::max(rect.y, ty << TILE_SHIFT);
+        int y1 = std::min(y_end, (ty + 1) << TILE_SHIFT);
+        for (int tx = rect.x >> TILE_SHIFT; tx <= (x_end - 1) >> TILE_SHIFT; ++tx) {
+            int x0 = std::max(rect.x, tx << TILE_SHIFT);
+            int x1 = std::min(x_end, (tx + 1) << TILE_SHIFT);
+            for (int y = y0; y < y1; ++y) {
+                Owner* row = owners + index(x0, y);
+                for (int x = 0; x < x1 - x0; ++x) {
+                    fn(row[x]);
+                }
+            }
+        }
+    }
+}
+
+void AttributionPlane::recordRect(const CanvasRect& rect, PixelOwner owner) {
+    if (!rect.valid()) {
+        return;
+    }
+    forEachInRect(owners_.data(), rect, [&](PixelOwner& pixel) { pixel = owner; });
+}
+
+std::vector<RegionOwner> AttributionPlane::summarize(const CanvasRect& rect) const {
+    std::vector<RegionOwner> owners;
+    if (!rect.valid()) {
+        return owners;
+    }
+    // index into owners by user and address
+    std::unordered_map<uint32_t, size_t> slots;
+    forEachInRect(owners_.data(), rect, [&](const PixelOwner& pixel) {
+        if (pixel.time == 0) {
+            return;
+        }
+        uint32_t key = (uint32_t(pixel.user) << 16) | pixel.address;
+        auto [it, inserted] = slots.emplace(key, owners.size());
+        if (inserted) {
+            owners.push_back({pixel.user, pixel.address, 0, 0});
+        }
+        RegionOwner& owner = owners[it->second];
+        owner.pixels++;
+        owner.last_time = std::max(owner.last_time, pixel.time);
+    });
+    std::sort(owners.begin(), owners.end(),
+              [](const RegionOwner& a, const RegionOwner& b) { return a.pixels > b.pixels; });
+    return owners;
+}
+
+void AttributionPlane::clear() {
+    std::fill(owners_.begin(), owners_.end(), PixelOwner{});
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "canvas_kernels.h"
+#include "config.h"
+
+using InternId = uint16_t;
+
+// Id 0, for unnamed clients and when a table is full
+const InternId UNKNOWN_ID = 0;
+
+// Maps strings (flipper names, addresses) to small ids so per pixel data stays compact.
+// Ids are never reused, once MAX_INTERNED strings are known new ones map to UNKNOWN_ID.
+class Interner {
+public:
+    Interner();
+
+    InternId intern(std::string_view text);
+    // Adds a name that intern() never hands out, e.g. for operations not made by a client
+    InternId reserve(std::string_view label);
+    // UNKNOWN_ID when text was never interned
+    InternId find(std::string_view text) const;
+
+    const std::string& text(InternId id) const;
+    size_t size() const { return texts_.size(); }
+
+private:
+    std::unordered_map<std::string, InternId> ids_;
+    std::vector<std::string> texts_;
+};
+
+// Who last wrote a pixel, 8 bytes
+struct PixelOwner {
+    uint32_t time = 0; // unix seconds, 0 when never painted since start
+    InternId user = UNKNOWN_ID;
+    InternId address = UNKNOWN_ID;
+};
+
+// Pixels and the latest write of one user/address pair inside a queried region
+struct RegionOwner {
+    InternId user;
+    InternId address;
+    uint32_t pixels;
+    uint32_t last_time;
+};
+
+// Last writer of every pixel, next to the canvas bits. Stored in ATTRIBUTION_TILE sized square
+// tiles, so a region (a stroke, a moderation query) touches a few contiguous blocks instead of
+// one cache line per row.
+class AttributionPlane {
+public:
+    AttributionPlane();
+
+    void record(int x, int y, PixelOwner owner) { owners_[index(x, y)] = owner; }
+    void recordRect(const CanvasRect& rect, PixelOwner owner);
+    PixelOwner at(int x, int y) const { return owners_[index(x, y)]; }
+
+    // Owners inside rect, most pixels first
+    std::vector<RegionOwner> summarize(const CanvasRect& rect) const;
+
+    void clear();
+
+private:
+    static constexpr int TILE_SHIFT = 4;
+    static constexpr int TILE = 1 << TILE_SHIFT;
+    static constexpr int TILES_X = (CANVAS_WIDTH + TILE - 1) / TILE;
+    static constexpr int TILES_Y = (CANVAS_HEIGHT + TILE - 1) / TILE;
+
+    static size_t index(int x, int y) {
+        size_t tile = size_t(y >> TILE_SHIFT) * TILES_X + size_t(x >> TILE_SHIFT);
+        return (tile << (2 * TILE_SHIFT)) | (size_t(y & (TILE - 1)) << TILE_SHIFT) | size_t(x & (TILE - 1));
+    }
+
+    // Calls fn(owner) for every pixel of rect, a tile at a time. Owner is PixelOwner or const PixelOwner.
+    template <typename Owner, typename Fn>
+    static void forEachInRect(Owner* owners, const CanvasRect& rect, Fn&& fn);
+
+    std::vector<PixelOwner> owners_;
+};
@@ -0,0 +1,115 @@
+#include "canvas.h"
+
+#include <bit>
+#include <fstream>
+#include <iostream>
+
+// The byte view of the words is only the LSB-first bit stream on little endian hosts
+static_assert(std::endian::native == std::endian::little, "Canvas words assume a little endian host");
+
+Canvas::Canvas() : words_((PAINTED_BYTES_SIZE + 7) / 8, 0) {}
+
+bool Canvas::setPixel(int x, int y, bool color) {
+    if (x < 0 || x >= CANVAS_WIDTH || y < 0 || y >= CANVAS_HEIGHT) {
+        std::cerr << "Invalid pixel coordinates: (" << x << ", " << y << ")" << std::endl;
+        return false;
+    }
+
+    uint8_t* painted_bytes = bytes();
+    size_t index = (y * CANVAS_WIDTH + x) / 8;
+    size_t bit = (y * CANVAS_WIDTH + x) % 8;
+
+    if (color) {
+        painted_bytes[index] |= (1 << bit); // Set the bit to 1
+    } else {
+        painted_bytes[index] &= ~(1 << bit); // Set the bit to 0
+    }
+    version_++;
+    return true;
+}
+
+bool Canvas::getPixel(int x, int y) const {
+    if (x < 0 || x >= CANVAS_WIDTH || y < 0 || y >= CANVAS_HEIGHT) {
+        return false;
+    }
+    size_t index = (y * CANVAS_WIDTH + x) / 8;
+    size_t bit = (y * CANVAS_WIDTH + x) % 8;
+    return bytes()[index] & (1 << bit);
+}
+
+bool Canvas::fillRun(int x, int y, int length, bool color) {
+    return fillRect(x, y, length, 1, color);
+}
+
+bool Canvas::fillRect(int x, int y, int width, int height, bool color) {
+    CanvasRect rect{x, y, width, height};
+    if (!rect.valid()) {
+        return false;
+    }
+    kernels::fillRect(words_.data(), rect, color);
+    version_++;
+    return true;
+}
+
+bool Canvas::setPixels(const CanvasPoint* points, size_t count, bool color) {
+    for (size_t i = 0; i < count; ++i) {
+        if (points[i].x >= CANVAS_WIDTH || points[i].y >= CANVAS_HEIGHT) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        size_t index = size_t(points[i].y) * CANVAS_WIDTH + points[i].x;
+        kernels::writeBits(words_.data(), index, 1, color);
+    }
+    version_++;
+    return true;
+}
+
+bool Canvas::blit(const CanvasRect& rect, const uint64_t* bitmap, const uint64_t* mask) {
+    if (!rect.valid()) {
+        return false;
+    }
+    kernels::blitRect(words_.data(), rect, bitmap, mask);
+    version_++;
+    return true;
+}
+
+size_t Canvas::countPainted() const {
+    // the padding bits behind the last pixel are never set
+    return kernels::popcount(words_.data(), words_.size());
+}
+
+size_t Canvas::countPainted(const CanvasRect& rect) const {
+    return rect.valid() ? kernels::popcountRect(words_.data(), rect) : 0;
+}
+
+bool Canvas::loadFromFile(const std::string& filename) {
+    std::ifstream in_file(filename, std::ios::binary);
+    if (!in_file) {
+        std::cerr << "Failed to open file for loading: " << filename << std::endl;
+        return false;
+    }
+    in_file.read(reinterpret_cast<char*>(bytes()), size());
+    if (!in_file) {
+        std::cerr << "Failed to read canvas from file: " << filename << std::endl;
+        return false;
+    }
+    version_++;
+    std::cout << "Canvas loaded from file: " << filename << std::endl;
+    return true;
+}
+
+bool Canvas::saveToFile(const std::string& filename) const {
+    std::ofstream out_file(filename, std::ios::binary);
+    if (!out_file) {
+        std::cerr << "Failed to open file for saving: " << filename << std::endl;
+        return false;
+    }
+    out_file.write(reinterpret_cast<const char*>(bytes()), size());
+    if (!out_file) {
+        std::cerr << "Failed to write canvas to file: " << filename << std::endl;
+        return false;
+    }
+    std::cout << "Canvas saved to file: " << filename << std::endl;
+    return true;
+}
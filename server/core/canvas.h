@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "canvas_kernels.h"
+#include "config.h"
+
+// The shared 1-bit canvas, stored row-major with 8 pixels per byte (LSB first).
+// Backed by 64-bit words so bulk operations can work a word at a time, the byte
+// view is the same memory and keeps the on-disk and wire layout.
+class Canvas {
+public:
+    Canvas();
+
+    // Sets a pixel at (x, y) to the specified color (1 = painted, 0 = not painted)
+    bool setPixel(int x, int y, bool color);
+    bool getPixel(int x, int y) const;
+
+    // Bulk placements, each is a single version step. Return false when out of bounds.
+    bool fillRun(int x, int y, int length, bool color);
+    bool fillRect(int x, int y, int width, int height, bool color);
+    // A [PIXELS] list, nothing is set unless every point is on the canvas
+    bool setPixels(const CanvasPoint* points, size_t count, bool color);
+    // Stamp a packed bitmap (see kernels::blitRect), optionally only where mask is set
+    bool blit(const CanvasRect& rect, const uint64_t* bitmap, const uint64_t* mask = nullptr);
+
+    // Painted pixels in the whole canvas or in rect
+    size_t countPainted() const;
+    size_t countPainted(const CanvasRect& rect) const;
+
+    uint8_t* bytes() { return reinterpret_cast<uint8_t*>(words_.data()); }
+    const uint8_t* bytes() const { return reinterpret_cast<const uint8_t*>(words_.data()); }
+    size_t size() const { return PAINTED_BYTES_SIZE; }
+
+    uint64_t* words() { return words_.data(); }
+    const uint64_t* words() const { return words_.data(); }
+    size_t wordCount() const { return words_.size(); }
+
+    // Bumped by every placement, doubles as the sequence number acknowledged to clients
+    uint64_t version() const { return version_; }
+
+    bool loadFromFile(const std::string& filename);
+    bool saveToFile(const std::string& filename) const;
+
+private:
+    std::vector<uint64_t> words_;
+    uint64_t version_ = 0;
+};
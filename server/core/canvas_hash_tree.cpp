@@ -0,0 +1,121 @@
+#include "canvas_hash_tree.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "canvas_kernels.h"
+
+namespace {
+
+const uint32_t FNV_OFFSET = 2166136261u;
+const uint32_t FNV_PRIME = 16777619u;
+
+uint32_t fnv1a(uint32_t hash, const uint8_t* bytes, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+} // namespace
+
+CanvasHashTree::CanvasHashTree() {
+    for (int depth = 0; depth <= DEPTH; ++depth) {
+        levels_[depth].assign(size_t(1) << (2 * depth), 0);
+    }
+    dirty_.assign(size_t(TILES_ACROSS) * TILES_ACROSS, 1);
+    words_.assign((PAINTED_BYTES_SIZE + 7) / 8, 0);
+    diff_.resize(words_.size());
+}
+
+bool CanvasHashTree::pixel(int x, int y) const {
+    size_t bit = size_t(y) * CANVAS_WIDTH + x;
+    return (words_[bit / 64] >> (bit % 64)) & 1;
+}
+
+CanvasHashTree::TileRect CanvasHashTree::tileRect(int x, int y) {
+    int left = x * TILE_SIZE, top = y * TILE_SIZE;
+    return {left, top, std::clamp(CANVAS_WIDTH - left, 0, TILE_SIZE), std::clamp(CANVAS_HEIGHT - top, 0, TILE_SIZE)};
+}
+
+std::vector<uint8_t> CanvasHashTree::tileBytes(int x, int y) const {
+    TileRect rect = tileRect(x, y);
+    size_t row_bytes = (rect.width + 7) / 8;
+    std::vector<uint8_t> bytes(row_bytes * rect.height, 0);
+    for (int row = 0; row < rect.height; ++row) {
+        for (int column = 0; column < rect.width; ++column) {
+            if (pixel(rect.x + column, rect.y + row)) {
+                bytes[row * row_bytes + column / 8] |= uint8_t(1 << (column % 8));
+            }
+        }
+    }
+    return bytes;
+}
+
+void CanvasHashTree::hashTile(int x, int y) {
+    std::vector<uint8_t> bytes = tileBytes(x, y);
+    levels_[DEPTH][size_t(y) * TILES_ACROSS + x] = fnv1a(FNV_OFFSET, bytes.data(), bytes.size());
+}
+
+bool CanvasHashTree::update(const Canvas& canvas) {
+    if (canvas.version() == version_) {
+        return false;
+    }
+    size_t changed = kernels::xorDiff(words_.data(), canvas.words(), diff_.data(), diff_.size());
+    bool first = version_ == UINT64_MAX;
+    version_ = canvas.version();
+    if (changed == 0 && !first) {
+        return false;
+    }
+    std::copy(canvas.words(), canvas.words() + canvas.wordCount(), words_.begin());
+
+    for (size_t word = 0; word < diff_.size(); ++word) {
+        for (uint64_t bits = diff_[word]; bits; bits &= bits - 1) {
+            size_t pixel = word * 64 + std::countr_zero(bits);
+            int x = int(pixel % CANVAS_WIDTH), y = int(pixel / CANVAS_WIDTH);
+            dirty_[size_t(y / TILE_SIZE) * TILES_ACROSS + x / TILE_SIZE] = 1;
+        }
+    }
+    for (int y = 0; y < TILES_ACROSS; ++y) {
+        for (int x = 0; x < TILES_ACROSS; ++x) {
+            if (dirty_[size_t(y) * TILES_ACROSS + x]) {
+                hashTile(x, y);
+            }
+        }
+    }
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+
+    // 85 nodes above the tiles, rehashing all of them costs less than tracking which
+    for (int depth = DEPTH - 1; depth >= 0; --depth) {
+        int across = 1 << depth;
+        for (int y = 0; y < across; ++y) {
+            for (int x = 0; x < across; ++x) {
+                uint8_t children[16];
+                for (int quadrant = 0; quadrant < 4; ++quadrant) {
+                    uint32_t child = hash({depth + 1, x * 2 + (quadrant & 1), y * 2 + (quadrant >> 1)});
+                    for (int i = 0; i < 4; ++i) {
+                        children[quadrant * 4 + i] = uint8_t(child >> (8 * i));
+                    }
+                }
+                levels_[depth][size_t(y) * across + x] = fnv1a(FNV_OFFSET, children, sizeof(children));
+            }
+        }
+    }
+    return true;
+}
+
+std::optional<CanvasHashTree::Node> CanvasHashTree::parsePath(std::string_view path) {
+    if (path.size() > DEPTH) {
+        return std::nullopt;
+    }
+    Node node{0, 0, 0};
+    for (char digit : path) {
+        if (digit < '0' || digit > '3') {
+            return std::nullopt;
+        }
+        node.depth++;
+        node.x = node.x * 2 + ((digit - '0') & 1);
+        node.y = node.y * 2 + ((digit - '0') >> 1);
+    }
+    return node;
+}
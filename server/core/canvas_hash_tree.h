@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "canvas.h"
+
+// A hash tree over TILE_SIZE square tiles of the canvas, so a client can find the tiles it has
+// wrong by walking down from the root instead of fetching everything again.
+//
+// Nodes are addressed by a path of quadrant digits from the root, 0 top left, 1 top right,
+// 2 bottom left, 3 bottom right. "" is the root and DEPTH digits name a tile.
+// A tile hashes its rows one after another, each packed LSB first into whole bytes (a 20 pixel
+// wide edge tile takes 3 bytes per row), a node hashes the four child hashes as little endian
+// words. Both are 32-bit FNV-1a, cheap enough to recompute on a Flipper.
+//
+// Kept up to date like CanvasPyramid: only tiles with pixels that changed since the last update
+// are hashed again.
+class CanvasHashTree {
+public:
+    static constexpr int TILE_SIZE = 32;
+    static constexpr int DEPTH = 4;
+    static constexpr int TILES_ACROSS = 1 << DEPTH; // 16 * 32 covers the 500 pixel canvas
+    static_assert(TILES_ACROSS * TILE_SIZE >= CANVAS_WIDTH && TILES_ACROSS * TILE_SIZE >= CANVAS_HEIGHT);
+
+    struct Node {
+        int depth;
+        int x, y; // in units of the node size at depth
+    };
+
+    // Tile area in canvas pixels, clipped to the canvas
+    struct TileRect {
+        int x, y, width, height;
+    };
+
+    CanvasHashTree();
+
+    // Apply what changed since the last call, returns false when the canvas is unchanged
+    bool update(const Canvas& canvas);
+
+    uint32_t hash(const Node& node) const { return levels_[node.depth][size_t(node.y) * (1 << node.depth) + node.x]; }
+    uint32_t root() const { return levels_[0][0]; }
+
+    // nullopt unless path is at most DEPTH quadrant digits
+    static std::optional<Node> parsePath(std::string_view path);
+    static TileRect tileRect(int x, int y);
+    // The tile's rows packed as they are hashed
+    std::vector<uint8_t> tileBytes(int x, int y) const;
+
+private:
+    bool pixel(int x, int y) const;
+    void hashTile(int x, int y);
+
+    std::vector<uint32_t> levels_[DEPTH + 1]; // levels_[depth], row-major
+    std::vector<uint8_t> dirty_; // per tile
+    std::vector<uint64_t> words_; // the canvas at the last update
+    std::vector<uint64_t> diff_;
+    uint64_t version_ = UINT64_MAX;
+};
@@ -0,0 +1,45 @@
+#include "canvas_history.h"
+
+#include "config.h"
+#include "png.h"
+#include "timelapse.h"
+
+CanvasHistory::CanvasHistory(TimelapseWriter& timelapse, size_t capacity)
+    : timelapse_(timelapse), capacity_(capacity) {}
+
+bool CanvasHistory::final(uint32_t t) const {
+    // a capture records the changes up to its own second
+    return t < timelapse_.lastCapture();
+}
+
+std::shared_ptr<HistoryState> CanvasHistory::at(uint32_t t) {
+    auto it = lookup_.find(t);
+    if (it != lookup_.end()) {
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+    }
+
+    auto state = std::make_shared<HistoryState>();
+    state->time = t;
+    if (!timelapse_.canvasAt(t, state->bytes)) {
+        return nullptr;
+    }
+    // the present can still change, only settled states are worth keeping
+    if (!final(t) || capacity_ == 0) {
+        return state;
+    }
+    entries_.emplace_front(t, state);
+    lookup_[t] = entries_.begin();
+    if (entries_.size() > capacity_) {
+        lookup_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+    return state;
+}
+
+const std::string& CanvasHistory::png(HistoryState& state) {
+    if (state.png.empty()) {
+        state.png = encodeBitmapPng(state.bytes.data(), CANVAS_WIDTH, CANVAS_HEIGHT);
+    }
+    return state.png;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TimelapseWriter;
+
+// A reconstructed past canvas, the PNG is encoded on first use
+struct HistoryState {
+    uint32_t time;
+    std::vector<uint8_t> bytes;
+    std::string png;
+};
+
+// Past canvas states for time travel queries, with the most recently used ones kept in memory
+// so scrubbing back and forth doesn't reconstruct every time
+class CanvasHistory {
+public:
+    CanvasHistory(TimelapseWriter& timelapse, size_t capacity);
+
+    // nullptr when nothing was recorded at or before t
+    std::shared_ptr<HistoryState> at(uint32_t t);
+    const std::string& png(HistoryState& state);
+
+    // Whether the state at t can't change anymore, so it may be cached by clients too
+    bool final(uint32_t t) const;
+
+private:
+    using Entry = std::pair<uint32_t, std::shared_ptr<HistoryState>>;
+
+    TimelapseWriter& timelapse_;
+    size_t capacity_;
+    // Most recently used first
+    std::list<Entry> entries_;
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> lookup_;
+};
@@ -0,0 +1,271 @@
+#include "canvas_kernels.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+
+#include "config.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PAINTERS_HAVE_AVX2_KERNELS 1
+#endif
+
+bool CanvasRect::valid() const {
+    return x >= 0 && y >= 0 && width > 0 && height > 0 && x + width <= CANVAS_WIDTH && y + height <= CANVAS_HEIGHT;
+}
+
+namespace kernels {
+
+namespace {
+
+inline uint64_t lowMask(unsigned count) {
+    return count >= 64 ? ~0ull : (1ull << count) - 1;
+}
+
+size_t popcountScalar(const uint64_t* words, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += std::popcount(words[i]);
+    }
+    return total;
+}
+
+size_t xorDiffScalar(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t diff = a[i] ^ b[i];
+        if (out) {
+            out[i] = diff;
+        }
+        total += std::popcount(diff);
+    }
+    return total;
+}
+
+#ifdef PAINTERS_HAVE_AVX2_KERNELS
+
+// Per-byte popcount with a nibble lookup (vpshufb), summed with vpsadbw
+__attribute__((target("avx2"))) inline __m256i popcountBytes(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(v, low_nibbles);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) inline size_t sumLanes(__m256i sums) {
+    return size_t(_mm256_extract_epi64(sums, 0)) + size_t(_mm256_extract_epi64(sums, 1)) +
+           size_t(_mm256_extract_epi64(sums, 2)) + size_t(_mm256_extract_epi64(sums, 3));
+}
+
+__attribute__((target("avx2"))) size_t popcountAvx2(const uint64_t* words, size_t count) {
+    __m256i sums = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        sums = _mm256_add_epi64(sums, popcountBytes(v));
+    }
+    return sumLanes(sums) + popcountScalar(words + i, count - i);
+}
+
+__attribute__((target("avx2"))) size_t xorDiffAvx2(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count) {
+    __m256i sums = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i diff = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        if (out) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), diff);
+        }
+        sums = _mm256_add_epi64(sums, popcountBytes(diff));
+    }
+    return sumLanes(sums) + xorDiffScalar(a + i, b + i, out ? out + i : nullptr, count - i);
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+struct Dispatch {
+    size_t (*popcount)(const uint64_t*, size_t);
+    size_t (*xor_diff)(const uint64_t*, const uint64_t*, uint64_t*, size_t);
+    const char* name;
+};
+
+const Dispatch SCALAR = {popcountScalar, xorDiffScalar, "scalar"};
+#ifdef PAINTERS_HAVE_AVX2_KERNELS
+const Dispatch AVX2 = {popcountAvx2, xorDiffAvx2, "avx2"};
+#endif
+
+Dispatch pickDispatch() {
+    const char* forced = std::getenv("PAINTERS_KERNELS");
+    if (forced && std::string_view(forced) == "scalar") {
+        return SCALAR;
+    }
+#ifdef PAINTERS_HAVE_AVX2_KERNELS
+    if (hasAvx2()) {
+        return AVX2;
+    }
+#endif
+    return SCALAR;
+}
+
+// Resolved on first use, so callers during static initialization get a valid table too
+Dispatch& dispatch() {
+    static Dispatch table = pickDispatch();
+    return table;
+}
+
+} // namespace
+
+void fillBits(uint64_t* words, size_t start, size_t end, bool color) {
+    if (start >= end) {
+        return;
+    }
+    size_t first = start / 64;
+    size_t last = (end - 1) / 64;
+    uint64_t head = ~0ull << (start % 64);
+    uint64_t tail = ~0ull >> (63 - (end - 1) % 64);
+
+    if (first == last) {
+        uint64_t mask = head & tail;
+        words[first] = color ? words[first] | mask : words[first] & ~mask;
+        return;
+    }
+    words[first] = color ? words[first] | head : words[first] & ~head;
+    for (size_t i = first + 1; i < last; ++i) {
+        words[i] = color ? ~0ull : 0;
+    }
+    words[last] = color ? words[last] | tail : words[last] & ~tail;
+}
+
+uint64_t readBits(const uint64_t* words, size_t start, unsigned count) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t word = start / 64;
+    unsigned offset = start % 64;
+    uint64_t value = words[word] >> offset;
+    if (offset + count > 64) {
+        value |= words[word + 1] << (64 - offset);
+    }
+    return value & lowMask(count);
+}
+
+void writeBits(uint64_t* words, size_t start, unsigned count, uint64_t value, uint64_t mask) {
+    if (count == 0) {
+        return;
+    }
+    mask &= lowMask(count);
+    value &= mask;
+    size_t word = start / 64;
+    unsigned offset = start % 64;
+    words[word] = (words[word] & ~(mask << offset)) | (value << offset);
+    if (offset + count > 64) {
+        unsigned shift = 64 - offset;
+        words[word + 1] = (words[word + 1] & ~(mask >> shift)) | (value >> shift);
+    }
+}
+
+void fillRect(uint64_t* canvas, const CanvasRect& rect, bool color) {
+    for (int row = rect.y; row < rect.y + rect.height; ++row) {
+        size_t start = size_t(row) * CANVAS_WIDTH + rect.x;
+        fillBits(canvas, start, start + rect.width, color);
+    }
+}
+
+void blitRect(uint64_t* canvas, const CanvasRect& rect, const uint64_t* bitmap, const uint64_t* mask) {
+    size_t source = 0;
+    for (int row = rect.y; row < rect.y + rect.height; ++row) {
+        size_t target = size_t(row) * CANVAS_WIDTH + rect.x;
+        // a 64-bit chunk of the source row at a time
+        for (int done = 0; done < rect.width; done += 64) {
+            unsigned count = unsigned(std::min(64, rect.width - done));
+            uint64_t bits = readBits(bitmap, source, count);
+            uint64_t keep = mask ? readBits(mask, source, count) : ~0ull;
+            writeBits(canvas, target, count, bits, keep);
+            source += count;
+            target += count;
+        }
+    }
+}
+
+void extractRect(const uint64_t* canvas, const CanvasRect& rect, uint64_t* bitmap) {
+    size_t words = (rect.area() + 63) / 64;
+    for (size_t i = 0; i < words; ++i) {
+        bitmap[i] = 0;
+    }
+    size_t target = 0;
+    for (int row = rect.y; row < rect.y + rect.height; ++row) {
+        size_t source = size_t(row) * CANVAS_WIDTH + rect.x;
+        for (int done = 0; done < rect.width; done += 64) {
+            unsigned count = unsigned(std::min(64, rect.width - done));
+            writeBits(bitmap, target, count, readBits(canvas, source, count));
+            source += count;
+            target += count;
+        }
+    }
+}
+
+size_t popcountBits(const uint64_t* words, size_t start, size_t end) {
+    if (start >= end) {
+        return 0;
+    }
+    size_t first = start / 64;
+    size_t last = (end - 1) / 64;
+    uint64_t head = ~0ull << (start % 64);
+    uint64_t tail = ~0ull >> (63 - (end - 1) % 64);
+    if (first == last) {
+        return std::popcount(words[first] & head & tail);
+    }
+    return std::popcount(words[first] & head) + std::popcount(words[last] & tail) +
+           popcount(words + first + 1, last - first - 1);
+}
+
+size_t popcountRect(const uint64_t* canvas, const CanvasRect& rect) {
+    // full width rows are one contiguous range of the bit stream
+    if (rect.x == 0 && rect.width == CANVAS_WIDTH) {
+        size_t start = size_t(rect.y) * CANVAS_WIDTH;
+        return popcountBits(canvas, start, start + rect.area());
+    }
+    size_t total = 0;
+    for (int row = rect.y; row < rect.y + rect.height; ++row) {
+        size_t start = size_t(row) * CANVAS_WIDTH + rect.x;
+        total += popcountBits(canvas, start, start + rect.width);
+    }
+    return total;
+}
+
+size_t popcount(const uint64_t* words, size_t count) {
+    return dispatch().popcount(words, count);
+}
+
+size_t xorDiff(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count) {
+    return dispatch().xor_diff(a, b, out, count);
+}
+
+const char* implementation() {
+    return dispatch().name;
+}
+
+bool setImplementation(std::string_view name) {
+    if (name == SCALAR.name) {
+        dispatch() = SCALAR;
+        return true;
+    }
+#ifdef PAINTERS_HAVE_AVX2_KERNELS
+    if (name == AVX2.name && hasAvx2()) {
+        dispatch() = AVX2;
+        return true;
+    }
+#endif
+    return false;
+}
+
+} // namespace kernels
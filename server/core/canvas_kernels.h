@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Bit kernels over the canvas bit stream: pixel (x, y) is bit y * CANVAS_WIDTH + x,
+// stored LSB first in 64-bit words. Row spans are handled with head/tail masks and
+// whole-word stores, whole-buffer passes use AVX2 when the CPU has it.
+
+struct CanvasPoint {
+    uint16_t x;
+    uint16_t y;
+};
+
+struct CanvasRect {
+    int x;
+    int y;
+    int width;
+    int height;
+
+    bool valid() const;
+    size_t area() const { return size_t(width) * size_t(height); }
+};
+
+namespace kernels {
+
+// Sets or clears the bits [start, end)
+void fillBits(uint64_t* words, size_t start, size_t end, bool color);
+// Reads count (<= 64) bits starting at bit start, bit 0 of the result is bit start
+uint64_t readBits(const uint64_t* words, size_t start, unsigned count);
+// Writes the low count (<= 64) bits of value at bit start, keeps the bits where mask is 0
+void writeBits(uint64_t* words, size_t start, unsigned count, uint64_t value, uint64_t mask = ~0ull);
+
+void fillRect(uint64_t* canvas, const CanvasRect& rect, bool color);
+// Clear is fillRect with color 0, kept for readability at call sites
+inline void clearRect(uint64_t* canvas, const CanvasRect& rect) { fillRect(canvas, rect, false); }
+
+// Copies a bitmap of rect.width * rect.height bits (rows packed back to back, LSB first)
+// into rect. With a mask in the same layout only pixels with a set mask bit are written.
+void blitRect(uint64_t* canvas, const CanvasRect& rect, const uint64_t* bitmap, const uint64_t* mask = nullptr);
+// The opposite of blitRect, packs rect into bitmap (which must hold area() bits rounded up to words)
+void extractRect(const uint64_t* canvas, const CanvasRect& rect, uint64_t* bitmap);
+
+// Set bits in [start, end), in rect, or in a whole buffer of count words
+size_t popcountBits(const uint64_t* words, size_t start, size_t end);
+size_t popcountRect(const uint64_t* canvas, const CanvasRect& rect);
+size_t popcount(const uint64_t* words, size_t count);
+
+// out = a ^ b, returns the number of differing bits. out may be nullptr to only count.
+size_t xorDiff(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t count);
+
+// Name of the implementation picked at startup, "avx2" or "scalar".
+// PAINTERS_KERNELS=scalar in the environment keeps AVX2 off.
+const char* implementation();
+// Switch to "avx2" or "scalar" for tests and benchmarks, false when the CPU can't run it
+bool setImplementation(std::string_view name);
+
+} // namespace kernels
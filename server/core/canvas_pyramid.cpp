@@ -0,0 +1,140 @@
+#include "canvas_pyramid.h"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+#include "canvas_kernels.h"
+#include "png.h"
+
+CanvasPyramid::CanvasPyramid() {
+    widths_[0] = CANVAS_WIDTH;
+    heights_[0] = CANVAS_HEIGHT;
+    for (int level = 1; level < LEVELS; ++level) {
+        widths_[level] = (widths_[level - 1] + 1) / 2;
+        heights_[level] = (heights_[level - 1] + 1) / 2;
+        counts_[level].assign(size_t(widths_[level]) * heights_[level], 0);
+    }
+    for (int zoom = 0; zoom <= MAX_TILE_ZOOM; ++zoom) {
+        tiles_[zoom].resize(size_t(tilesAcross(zoom)) * tilesDown(zoom));
+    }
+    words_.assign((PAINTED_BYTES_SIZE + 7) / 8, 0);
+    diff_.resize(words_.size());
+    scratch_.resize(size_t(TILE_SIZE) * TILE_SIZE);
+    std::fill(std::begin(overview_dirty_), std::end(overview_dirty_), true);
+}
+
+uint32_t CanvasPyramid::count(int level, int x, int y) const {
+    if (level == 0) {
+        size_t bit = size_t(y) * CANVAS_WIDTH + x;
+        return (words_[bit / 64] >> (bit % 64)) & 1;
+    }
+    return counts_[level][size_t(y) * widths_[level] + x];
+}
+
+void CanvasPyramid::markDirty(int level, int x, int y) {
+    int zoom = MAX_TILE_ZOOM - level;
+    if (zoom >= 0) {
+        tiles_[zoom][size_t(y / TILE_SIZE) * tilesAcross(zoom) + x / TILE_SIZE].generation++;
+    }
+}
+
+void CanvasPyramid::rebuild() {
+    for (int level = 1; level < LEVELS; ++level) {
+        std::fill(counts_[level].begin(), counts_[level].end(), 0);
+        for (int y = 0; y < heights_[level - 1]; ++y) {
+            for (int x = 0; x < widths_[level - 1]; ++x) {
+                counts_[level][size_t(y / 2) * widths_[level] + x / 2] += count(level - 1, x, y);
+            }
+        }
+    }
+    for (auto& tiles : tiles_) {
+        for (Tile& tile : tiles) {
+            tile.generation++;
+        }
+    }
+    std::fill(std::begin(overview_dirty_), std::end(overview_dirty_), true);
+}
+
+bool CanvasPyramid::update(const Canvas& canvas) {
+    if (canvas.version() == version_) {
+        return false;
+    }
+    size_t changed = kernels::xorDiff(words_.data(), canvas.words(), diff_.data(), diff_.size());
+    bool first = version_ == UINT64_MAX;
+    version_ = canvas.version();
+    if (changed == 0 && !first) {
+        return false;
+    }
+    std::copy(canvas.words(), canvas.words() + canvas.wordCount(), words_.begin());
+
+    // past a few thousand pixels walking up every level costs more than recounting
+    if (first || changed > PAINTED_BYTES_SIZE / 4) {
+        rebuild();
+        return true;
+    }
+    std::fill(std::begin(overview_dirty_), std::end(overview_dirty_), true);
+    for (size_t word = 0; word < diff_.size(); ++word) {
+        for (uint64_t bits = diff_[word]; bits; bits &= bits - 1) {
+            size_t pixel = word * 64 + std::countr_zero(bits);
+            int x = int(pixel % CANVAS_WIDTH), y = int(pixel / CANVAS_WIDTH);
+            bool painted = (words_[word] >> (pixel % 64)) & 1;
+            markDirty(0, x, y);
+            for (int level = 1; level < LEVELS; ++level) {
+                x /= 2;
+                y /= 2;
+                uint32_t& cell = counts_[level][size_t(y) * widths_[level] + x];
+                cell = painted ? cell + 1 : cell - 1;
+                markDirty(level, x, y);
+            }
+        }
+    }
+    return true;
+}
+
+const std::vector<uint8_t>& CanvasPyramid::overview(int level) {
+    std::vector<uint8_t>& bits = overviews_[level];
+    if (!overview_dirty_[level]) {
+        return bits;
+    }
+    // an eighth keeps single pixel lines visible at every level
+    uint32_t threshold = std::max<uint32_t>(1, (uint32_t(1) << (2 * level)) / 8);
+    bits.assign(overviewSize(level), 0);
+    size_t bit = 0;
+    for (int y = 0; y < heights_[level]; ++y) {
+        for (int x = 0; x < widths_[level]; ++x, ++bit) {
+            if (count(level, x, y) >= threshold) {
+                bits[bit / 8] |= uint8_t(1 << (bit % 8));
+            }
+        }
+    }
+    overview_dirty_[level] = false;
+    return bits;
+}
+
+const CanvasPyramid::Tile* CanvasPyramid::tile(int zoom, int x, int y) {
+    if (zoom < 0 || zoom > MAX_TILE_ZOOM || x < 0 || y < 0 || x >= tilesAcross(zoom) || y >= tilesDown(zoom)) {
+        return nullptr;
+    }
+    Tile& tile = tiles_[zoom][size_t(y) * tilesAcross(zoom) + x];
+    if (tile.encoded == tile.generation) {
+        return &tile;
+    }
+
+    // white where nothing is painted, darker the more of the block is, white outside the canvas
+    int level = MAX_TILE_ZOOM - zoom;
+    uint32_t block = uint32_t(1) << (2 * level);
+    for (int ty = 0; ty < TILE_SIZE; ++ty) {
+        for (int tx = 0; tx < TILE_SIZE; ++tx) {
+            int cx = x * TILE_SIZE + tx, cy = y * TILE_SIZE + ty;
+            uint8_t gray = 255;
+            if (cx < widths_[level] && cy < heights_[level]) {
+                gray = uint8_t(255 - count(level, cx, cy) * 255 / block);
+            }
+            scratch_[size_t(ty) * TILE_SIZE + tx] = gray;
+        }
+    }
+    tile.png = encodeGrayPng(scratch_.data(), TILE_SIZE, TILE_SIZE);
+    tile.encoded = tile.generation;
+    return &tile;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "canvas.h"
+
+// Downsampled views of the canvas for spectators. Level 0 is the canvas, every level above holds
+// the painted pixel count of each 2x2 block of the level below, up to a single cell.
+// Kept up to date incrementally: only pixels that changed since the last update touch the counts,
+// and only the tiles they fall in are re-encoded.
+//
+// Tiles are TILE_SIZE square grayscale PNGs. Zoom 0 is level MAX_TILE_ZOOM (the whole canvas in
+// one tile), zoom MAX_TILE_ZOOM is the canvas at full resolution.
+class CanvasPyramid {
+public:
+    static constexpr int LEVELS = 10; // 500 -> 250 -> ... -> 1
+    static constexpr int TILE_SIZE = 64;
+    static constexpr int MAX_TILE_ZOOM = 3;
+
+    struct Tile {
+        std::string png;
+        uint32_t generation = 0; // bumped when a pixel in the tile changes
+        uint32_t encoded = UINT32_MAX; // generation the png is from
+    };
+
+    CanvasPyramid();
+
+    // Apply what changed since the last call, returns false when the canvas is unchanged
+    bool update(const Canvas& canvas);
+
+    int width(int level) const { return widths_[level]; }
+    int height(int level) const { return heights_[level]; }
+    // Painted pixels in the 2^level square block at (x, y) of level
+    uint32_t count(int level, int x, int y) const;
+
+    // Level as a packed bitmap (rows back to back, LSB first, like the canvas) where a cell is set
+    // when at least an eighth of its block is painted, rebuilt only after the level changed
+    const std::vector<uint8_t>& overview(int level);
+    // Bytes in overview(level), fixed by the canvas size so it is known without an update
+    size_t overviewSize(int level) const { return (size_t(widths_[level]) * heights_[level] + 7) / 8; }
+
+    // The encoded tile, nullptr when it is outside the canvas
+    const Tile* tile(int zoom, int x, int y);
+    int tilesAcross(int zoom) const { return (widths_[MAX_TILE_ZOOM - zoom] + TILE_SIZE - 1) / TILE_SIZE; }
+    int tilesDown(int zoom) const { return (heights_[MAX_TILE_ZOOM - zoom] + TILE_SIZE - 1) / TILE_SIZE; }
+
+private:
+    void rebuild();
+    void markDirty(int level, int x, int y);
+
+    int widths_[LEVELS];
+    int heights_[LEVELS];
+    // counts_[level] for level >= 1, row-major
+    std::vector<uint32_t> counts_[LEVELS];
+    std::vector<uint64_t> words_; // the canvas at the last update
+    std::vector<uint64_t> diff_;
+    uint64_t version_ = UINT64_MAX;
+    // tiles_[zoom], row-major
+    std::vector<Tile> tiles_[MAX_TILE_ZOOM + 1];
+    std::vector<uint8_t> scratch_;
+    std::vector<uint8_t> overviews_[LEVELS];
+    bool overview_dirty_[LEVELS];
+};
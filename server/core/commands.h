@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Commands a client can send, identified by the bracketed tag at the start of a message
+enum class Command : uint8_t {
+    Unknown,
+    Stop,
+    MapSync,
+    Name,
+    Pixel,
+    Pixels,
+    MapOverview,
+    MapHash,
+    MapTile,
+    MapResume,
+    Count
+};
+
+struct CommandTag {
+    std::string_view tag;
+    Command command;
+};
+
+// Every known tag, add new commands here and give them a handler in ServerCore
+inline constexpr CommandTag COMMAND_TAGS[] = {
+    {"PIXEL", Command::Pixel},
+    {"PIXELS", Command::Pixels},
+    {"NAME", Command::Name},
+    {"MAP/SYNC", Command::MapSync},
+    {"MAP/OVERVIEW", Command::MapOverview},
+    {"MAP/HASH", Command::MapHash},
+    {"MAP/TILE", Command::MapTile},
+    {"MAP/RESUME", Command::MapResume},
+    {"SOCKET/STOP", Command::Stop}, // FlipperHTTP sends [SOCKET/STOP] when closing
+    {"STOP", Command::Stop},
+};
+
+struct ParsedCommand {
+    Command command;
+    std::string_view message;  // the whole frame
+    std::string_view payload;  // everything after the closing ']'
+    std::string_view argument; // after the first ':' inside the brackets, "3" in "[MAP/OVERVIEW:3]"
+};
+
+namespace command_table {
+
+inline constexpr size_t MAX_TAG_LENGTH = 16;
+// the tag plus its argument
+inline constexpr size_t MAX_BRACKET_LENGTH = 48;
+inline constexpr unsigned TABLE_BITS = 5;
+inline constexpr size_t TABLE_SIZE = size_t(1) << TABLE_BITS;
+
+// Hash only the length and three characters so a lookup costs a multiply and one compare
+constexpr uint32_t tagKey(std::string_view tag) {
+    return uint32_t(tag.size()) | uint32_t(uint8_t(tag.front())) << 8 |
+           uint32_t(uint8_t(tag[tag.size() / 2])) << 16 | uint32_t(uint8_t(tag.back())) << 24;
+}
+
+constexpr size_t slotFor(std::string_view tag, uint32_t seed) {
+    return (tagKey(tag) * seed) >> (32 - TABLE_BITS);
+}
+
+constexpr bool isPerfect(uint32_t seed) {
+    std::array<bool, TABLE_SIZE> used{};
+    for (const auto& entry : COMMAND_TAGS) {
+        size_t slot = slotFor(entry.tag, seed);
+        if (used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+// Search an odd multiplier that maps every tag to its own slot
+constexpr uint32_t findSeed() {
+    for (uint32_t seed = 0x9E3779B1u; seed != 0x9E3779B1u + 2 * 100000; seed += 2) {
+        if (isPerfect(seed)) {
+            return seed;
+        }
+    }
+    return 0;
+}
+
+inline constexpr uint32_t SEED = findSeed();
+static_assert(SEED != 0, "No perfect hash for COMMAND_TAGS, grow TABLE_BITS");
+
+// slot -> index into COMMAND_TAGS + 1, 0 for an empty slot
+constexpr std::array<uint8_t, TABLE_SIZE> buildTable() {
+    std::array<uint8_t, TABLE_SIZE> table{};
+    for (size_t i = 0; i < std::size(COMMAND_TAGS); ++i) {
+        table[slotFor(COMMAND_TAGS[i].tag, SEED)] = uint8_t(i + 1);
+    }
+    return table;
+}
+
+inline constexpr std::array<uint8_t, TABLE_SIZE> TABLE = buildTable();
+
+} // namespace command_table
+
+constexpr Command lookupCommand(std::string_view tag) {
+    if (tag.empty() || tag.size() > command_table::MAX_TAG_LENGTH) {
+        return Command::Unknown;
+    }
+    uint8_t entry = command_table::TABLE[command_table::slotFor(tag, command_table::SEED)];
+    if (entry == 0 || COMMAND_TAGS[entry - 1].tag != tag) {
+        return Command::Unknown;
+    }
+    return COMMAND_TAGS[entry - 1].command;
+}
+
+// Split "[TAG]payload" or "[TAG:argument]payload" in a single pass over the message
+inline ParsedCommand parseCommand(std::string_view message) {
+    if (message.size() < 2 || message.front() != '[') {
+        return {Command::Unknown, message, message, {}};
+    }
+    size_t scan = std::min(message.size(), command_table::MAX_BRACKET_LENGTH + 2);
+    const void* close = std::memchr(message.data() + 1, ']', scan - 1);
+    if (!close) {
+        return {Command::Unknown, message, message, {}};
+    }
+    size_t close_pos = static_cast<const char*>(close) - message.data();
+    std::string_view bracket = message.substr(1, close_pos - 1);
+    std::string_view argument;
+    if (const void* colon = std::memchr(bracket.data(), ':', bracket.size())) {
+        size_t colon_pos = static_cast<const char*>(colon) - bracket.data();
+        argument = bracket.substr(colon_pos + 1);
+        bracket = bracket.substr(0, colon_pos);
+    }
+    return {lookupCommand(bracket), message, message.substr(close_pos + 1), argument};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+#define WEBSOCKET_PORT 80
+#define MAX_CLIENTS 75
+#define MAX_CLIENTS_PER_ADDRESS 4
+#define RESERVED_CLIENT_SLOTS 10 // part of MAX_CLIENTS kept for returning named clients
+#define NAMED_CLIENT_MEMORY (60 * 60) // seconds an address that sent [NAME] counts as returning
+#define ADMISSION_RETRY_AFTER 30 // seconds, sent in Retry-After when a connection is rejected
+#define SAVE_INTERVAL (10 * 60) // 10 minutes
+#define TIMELAPSE_KEYFRAME_INTERVAL (5 * 60) // seconds between full canvas keyframes in the timelapse
+#define HISTORY_CACHE_ENTRIES 32 // reconstructed past canvases kept for /history
+#define PIXEL_PLACE_TIMEOUT   1000 // 1 second in milliseconds
+#define PIXEL_PLACE_TIMEOUT_MAX (10 * 1000) // upper bound when the cooldown adapts to load
+#define LOAD_SAMPLE_INTERVAL  1000 // milliseconds between load samples
+#define BROADCAST_QUEUE_HIGH  (512 * 1024) // bytes waiting in all client send buffers
+#define LOOP_LAG_HIGH         50 // milliseconds the event loop is late for a load sample
+#define SPECTATOR_UPDATE_INTERVAL 250 // milliseconds between batched spectator updates
+#define PIXEL_BURST 1 // pixels an address may place back to back
+#define STROKE_BURST 32 // pixels a client may place at once in [PIXELS] batches
+#define STROKE_REFILL_INTERVAL 1000 // milliseconds to regain one batch pixel
+#define MAX_BATCH_POINTS 16 // coordinates in one [PIXELS] list
+#define MIN_OVERVIEW_LEVEL 3 // finest [MAP/OVERVIEW] level, 63x63 cells, the first that fits one frame
+#define SYNC_BURST 3 // full canvas syncs an address may request back to back
+#define SYNC_REFILL_INTERVAL (20 * 1000) // milliseconds to regain one canvas sync
+#define REPAIR_BURST 64 // tiles of [MAP/TILE], [MAP/HASH] and [MAP/OVERVIEW] data an address may fetch back to back
+#define REPAIR_REFILL_INTERVAL (SYNC_REFILL_INTERVAL / 256) // milliseconds to regain one tile, no faster than syncs
+#define SYNC_VIEW_ROWS 64 // rows from the client's view a paced sync sends first, one Flipper screen
+#define SYNC_BAND_ROWS 64 // rows per band a paced sync adds around the view after that
+#define MIN_LINK_RATE 1000 // bytes per second, slower advertised links are paced as this
+#define RATE_LIMIT_ADDRESSES (1 << 18) // addresses the rate limiter keeps track of
+#define PLACEMENT_HISTORY (1 << 20) // client placements kept for rollbacks, 24 bytes each
+#define MAX_HTTP_BODY_SIZE (128 * 1024) // bytes, a full canvas bitmap plus its mask fits
+
+// Canvas configuration
+const int CANVAS_WIDTH = 500;
+const int CANVAS_HEIGHT = 500;
+const size_t PAINTED_BYTES_SIZE = ((CANVAS_WIDTH * CANVAS_HEIGHT + 7) / 8); // 1 byte = 8 bits
+const int MAX_PAYLOAD_SIZE = 2048;
+const size_t MAX_MESSAGE_LENGTH = 160; // longest message accepted from a client
+const int CHUNK_SEND_DELAY_MS = 250; // Delay between sending chunks in milliseconds
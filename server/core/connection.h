@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "sync_plan.h"
+
+// Per-connection state the server keeps for every painter
+struct Session {
+    std::string flipper_name;
+    // interned name and address, what the attribution plane records for this painter
+    uint16_t user_id = 0;
+    uint16_t address_id = 0;
+    // set once the connection holds a slot in AdmissionControl
+    bool admitted = false;
+    // the client restored a cached canvas with [MAP/RESUME], [NAME] won't send a full one
+    bool resumed = false;
+    // bytes per second the client's link carries, advertised in [NAME:rate:y], 0 when unknown
+    uint32_t link_rate = 0;
+    // top row of the client's view, a paced sync starts there
+    int view_y = 0;
+    // the rest of a paced sync, sent a link's worth per tick
+    SyncPlan sync;
+};
+
+// A client connection as seen by the server core, implemented by each transport
+// (uWS sockets in production, in-memory connections for benchmarks and simulations)
+class Connection {
+public:
+    virtual ~Connection() = default;
+
+    virtual void send(std::string_view message, bool binary = false) = 0;
+    // Closing must end up in ServerCore::onClose for this connection
+    virtual void close() = 0;
+    virtual std::string_view remoteAddress() const = 0;
+    // Bytes queued for this connection but not yet written out
+    virtual size_t bufferedAmount() const { return 0; }
+
+    Session session;
+};
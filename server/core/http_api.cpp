@@ -0,0 +1,473 @@
+#include "http_api.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "canvas_history.h"
+#include "canvas_kernels.h"
+#include "canvas_pyramid.h"
+#include "config.h"
+#include "png.h"
+#include "server_core.h"
+
+namespace {
+
+// Owners listed for a region query, the total count is always reported
+const size_t MAX_ATTRIBUTION_OWNERS = 100;
+
+ApiResponse errorResponse(std::string status, std::string_view message) {
+    ApiResponse response;
+    response.status = std::move(status);
+    response.body = "{\"error\":\"" + std::string(message) + "\"}";
+    return response;
+}
+
+// Reads an optional query number, false when it is present but not a number
+template <typename T>
+bool readParam(std::string_view query, std::string_view key, T& value) {
+    std::optional<std::string_view> text = queryValue(query, key);
+    if (!text) {
+        return true;
+    }
+    auto [end, error] = std::from_chars(text->data(), text->data() + text->size(), value);
+    return error == std::errc() && end == text->data() + text->size();
+}
+
+// Names come from clients, escape what would break the JSON
+void appendJsonString(std::string& out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// If-None-Match holds "*" or a list of tags, weak ones prefixed with W/
+bool etagMatches(std::string_view if_none_match, std::string_view etag) {
+    while (!if_none_match.empty()) {
+        size_t comma = if_none_match.find(',');
+        std::string_view candidate = if_none_match.substr(0, comma);
+        if_none_match = comma == std::string_view::npos ? std::string_view() : if_none_match.substr(comma + 1);
+
+        while (!candidate.empty() && candidate.front() == ' ') {
+            candidate.remove_prefix(1);
+        }
+        while (!candidate.empty() && candidate.back() == ' ') {
+            candidate.remove_suffix(1);
+        }
+        if (candidate.starts_with("W/")) {
+            candidate.remove_prefix(2);
+        }
+        if (candidate == "*" || candidate == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ApiResponse getOnly() {
+    ApiResponse response = errorResponse("405 Method Not Allowed", "use GET");
+    response.headers.emplace_back("Allow", "GET");
+    return response;
+}
+
+} // namespace
+
+std::optional<std::string_view> queryValue(std::string_view query, std::string_view key) {
+    while (!query.empty()) {
+        size_t amp = query.find('&');
+        std::string_view pair = query.substr(0, amp);
+        query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+
+        size_t equals = pair.find('=');
+        if (pair.substr(0, equals) == key) {
+            return equals == std::string_view::npos ? std::string_view() : pair.substr(equals + 1);
+        }
+    }
+    return std::nullopt;
+}
+
+HttpApi::HttpApi(ServerCore& core, std::string admin_token, CanvasHistory* history)
+    : core_(core), admin_token_(std::move(admin_token)), history_(history) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    etag_epoch_ = std::to_string(std::chrono::duration_cast<std::chrono::seconds>(now).count());
+}
+
+std::optional<ApiResponse> HttpApi::handle(const ApiRequest& request) {
+    const std::string_view admin_prefix = "/admin/";
+    if (request.url.starts_with(admin_prefix)) {
+        return handleAdmin(request.url.substr(admin_prefix.size()), request);
+    }
+    if (request.url == "/history" && history_) {
+        return handleHistory(request);
+    }
+    if (request.url == "/canvas.png") {
+        return handleCanvasPng(request);
+    }
+    if (request.url == "/map.bin") {
+        return handleMapBin(request);
+    }
+    const std::string_view tiles_prefix = "/tiles/";
+    if (request.url.starts_with(tiles_prefix)) {
+        return handleTile(request.url.substr(tiles_prefix.size()), request);
+    }
+    return std::nullopt;
+}
+
+ApiResponse HttpApi::handleCanvasPng(const ApiRequest& request) {
+    if (request.method != "get") {
+        return getOnly();
+    }
+    const Canvas& canvas = core_.canvas();
+    ApiResponse response;
+    std::string etag = "\"" + etag_epoch_ + "-v" + std::to_string(canvas.version()) + "\"";
+    response.headers.emplace_back("ETag", etag);
+    response.headers.emplace_back("Cache-Control", "no-cache");
+    response.headers.emplace_back("Access-Control-Allow-Origin", "*");
+    if (etagMatches(request.if_none_match, etag)) {
+        response.status = "304 Not Modified";
+        response.content_type.clear();
+        return response;
+    }
+
+    // however many embeds ask, one encode per version
+    if (canvas_png_version_ != canvas.version()) {
+        canvas_png_ =
+            std::make_shared<const std::string>(encodeBitmapPng(canvas.bytes(), CANVAS_WIDTH, CANVAS_HEIGHT));
+        canvas_png_version_ = canvas.version();
+    }
+    response.content_type = "image/png";
+    response.shared = canvas_png_;
+    response.view = *canvas_png_;
+    return response;
+}
+
+ApiResponse HttpApi::handleMapBin(const ApiRequest& request) {
+    if (request.method != "get") {
+        return getOnly();
+    }
+    const Canvas& canvas = core_.canvas();
+    ApiResponse response;
+    std::string etag = "\"" + etag_epoch_ + "-v" + std::to_string(canvas.version()) + "\"";
+    response.headers.emplace_back("ETag", etag);
+    response.headers.emplace_back("Cache-Control", "no-cache");
+    response.headers.emplace_back("Accept-Ranges", "bytes");
+    if (etagMatches(request.if_none_match, etag)) {
+        response.status = "304 Not Modified";
+        response.content_type.clear();
+        return response;
+    }
+
+    if (snapshot_version_ != canvas.version()) {
+        snapshot_ = std::make_shared<const std::string>(reinterpret_cast<const char*>(canvas.bytes()), canvas.size());
+        snapshot_version_ = canvas.version();
+    }
+    response.content_type = "application/octet-stream";
+    response.shared = snapshot_;
+    response.view = *snapshot_;
+
+    // a single "bytes=first-last", "bytes=first-" or "bytes=-suffix", anything else gets the whole map
+    const std::string_view unit = "bytes=";
+    std::string_view range = request.range;
+    if (!range.starts_with(unit) || range.find(',') != std::string_view::npos) {
+        return response;
+    }
+    range.remove_prefix(unit.size());
+    size_t dash = range.find('-');
+    if (dash == std::string_view::npos) {
+        return response;
+    }
+    std::string_view first_text = range.substr(0, dash), last_text = range.substr(dash + 1);
+    size_t size = snapshot_->size(), first = 0, last = size - 1;
+    auto parse = [](std::string_view text, size_t& value) {
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return !text.empty() && error == std::errc() && end == text.data() + text.size();
+    };
+    if (first_text.empty()) {
+        size_t suffix;
+        if (!parse(last_text, suffix)) {
+            return response;
+        }
+        // the last suffix bytes, a zero length suffix can't be satisfied
+        first = suffix == 0 ? size : size - std::min(suffix, size);
+    } else {
+        if (!parse(first_text, first) || (!last_text.empty() && (!parse(last_text, last) || last < first))) {
+            return response;
+        }
+        last = std::min(last, size - 1);
+    }
+    if (first >= size) {
+        ApiResponse unsatisfiable = errorResponse("416 Range Not Satisfiable", "range outside the map");
+        unsatisfiable.headers.emplace_back("Content-Range", "bytes */" + std::to_string(size));
+        return unsatisfiable;
+    }
+
+    response.status = "206 Partial Content";
+    response.headers.emplace_back("Content-Range", "bytes " + std::to_string(first) + "-" + std::to_string(last) +
+                                                       "/" + std::to_string(size));
+    response.view = response.view.substr(first, last - first + 1);
+    return response;
+}
+
+ApiResponse HttpApi::handleTile(std::string_view path, const ApiRequest& request) {
+    if (request.method != "get") {
+        return getOnly();
+    }
+    // "{z}/{x}/{y}" with an optional ".png"
+    if (path.ends_with(".png")) {
+        path.remove_suffix(4);
+    }
+    int coordinates[3];
+    for (int i = 0; i < 3; ++i) {
+        size_t slash = path.find('/');
+        std::string_view part = path.substr(0, slash);
+        auto [end, error] = std::from_chars(part.data(), part.data() + part.size(), coordinates[i]);
+        if (error != std::errc() || end != part.data() + part.size() || part.empty() ||
+            (i < 2) == (slash == std::string_view::npos)) {
+            return errorResponse("400 Bad Request", "tiles are /tiles/{z}/{x}/{y}.png");
+        }
+        path = slash == std::string_view::npos ? std::string_view() : path.substr(slash + 1);
+    }
+
+    const CanvasPyramid::Tile* tile = core_.pyramid().tile(coordinates[0], coordinates[1], coordinates[2]);
+    if (!tile) {
+        return errorResponse("404 Not Found", "no such tile");
+    }
+
+    ApiResponse response;
+    std::string etag = "\"" + etag_epoch_ + "-" + std::to_string(tile->generation) + "\"";
+    response.headers.emplace_back("ETag", etag);
+    // spectators poll, let them revalidate cheaply instead of caching stale tiles
+    response.headers.emplace_back("Cache-Control", "no-cache");
+    response.headers.emplace_back("Access-Control-Allow-Origin", "*");
+    if (etagMatches(request.if_none_match, etag)) {
+        response.status = "304 Not Modified";
+        response.content_type.clear();
+        return response;
+    }
+    response.content_type = "image/png";
+    response.body = tile->png;
+    return response;
+}
+
+ApiResponse HttpApi::handleHistory(const ApiRequest& request) {
+    if (request.method != "get") {
+        return getOnly();
+    }
+    uint32_t t = 0;
+    if (!queryValue(request.query, "t") || !readParam(request.query, "t", t)) {
+        return errorResponse("400 Bad Request", "t must be a unix time in seconds");
+    }
+    std::string_view format = queryValue(request.query, "format").value_or("bin");
+    if (format != "bin" && format != "png") {
+        return errorResponse("400 Bad Request", "format is bin or png");
+    }
+
+    std::shared_ptr<HistoryState> state = history_->at(t);
+    if (!state) {
+        return errorResponse("404 Not Found", "no history recorded at that time");
+    }
+
+    ApiResponse response;
+    if (format == "png") {
+        response.content_type = "image/png";
+        response.body = history_->png(*state);
+    } else {
+        response.content_type = "application/octet-stream";
+        response.body.assign(state->bytes.begin(), state->bytes.end());
+    }
+    // the past doesn't change, the present still may
+    response.headers.emplace_back("Cache-Control",
+                                  history_->final(t) ? "public, max-age=31536000, immutable" : "no-cache");
+    return response;
+}
+
+bool HttpApi::authorized(std::string_view authorization) const {
+    const std::string_view scheme = "Bearer ";
+    if (!authorization.starts_with(scheme)) {
+        return false;
+    }
+    std::string_view token = authorization.substr(scheme.size());
+    if (token.size() != admin_token_.size()) {
+        return false;
+    }
+    // constant time, so the token can't be guessed a character at a time
+    unsigned char difference = 0;
+    for (size_t i = 0; i < token.size(); ++i) {
+        difference |= static_cast<unsigned char>(token[i] ^ admin_token_[i]);
+    }
+    return difference == 0;
+}
+
+ApiResponse HttpApi::handleAdmin(std::string_view action, const ApiRequest& request) {
+    if (!adminEnabled()) {
+        return errorResponse("403 Forbidden", "admin API disabled");
+    }
+    if (!authorized(request.authorization)) {
+        ApiResponse response = errorResponse("401 Unauthorized", "missing or wrong token");
+        response.headers.emplace_back("WWW-Authenticate", "Bearer");
+        return response;
+    }
+
+    if (action == "attribution") {
+        return handleAttribution(request);
+    }
+    if (action == "rollback") {
+        return handleRollback(request);
+    }
+
+    RegionOp op;
+    if (action == "clear") {
+        op = RegionOp::Clear;
+    } else if (action == "fill") {
+        op = RegionOp::Fill;
+    } else if (action == "stamp") {
+        op = RegionOp::Stamp;
+    } else {
+        return errorResponse("404 Not Found", "unknown admin action");
+    }
+    if (request.method != "post") {
+        ApiResponse response = errorResponse("405 Method Not Allowed", "use POST");
+        response.headers.emplace_back("Allow", "POST");
+        return response;
+    }
+
+    CanvasRect rect{0, 0, CANVAS_WIDTH, CANVAS_HEIGHT};
+    if (!readParam(request.query, "x", rect.x) || !readParam(request.query, "y", rect.y) ||
+        !readParam(request.query, "w", rect.width) || !readParam(request.query, "h", rect.height)) {
+        return errorResponse("400 Bad Request", "bad number in region");
+    }
+    if (!rect.valid()) {
+        return errorResponse("400 Bad Request", "region outside the canvas");
+    }
+
+    std::vector<uint64_t> bitmap, mask;
+    if (op == RegionOp::Stamp) {
+        size_t bitmap_bytes = (rect.area() + 7) / 8;
+        size_t bitmap_words = (rect.area() + 63) / 64;
+        if (request.body.size() != bitmap_bytes && request.body.size() != bitmap_bytes * 2) {
+            return errorResponse("400 Bad Request", "body must be " + std::to_string(bitmap_bytes) +
+                                                        " bitmap bytes, optionally followed by as many mask bytes");
+        }
+        // copy into words, the body has no alignment guarantees
+        bitmap.assign(bitmap_words, 0);
+        std::memcpy(bitmap.data(), request.body.data(), bitmap_bytes);
+        if (request.body.size() == bitmap_bytes * 2) {
+            mask.assign(bitmap_words, 0);
+            std::memcpy(mask.data(), request.body.data() + bitmap_bytes, bitmap_bytes);
+        }
+    }
+
+    size_t changed = core_.applyRegion(op, rect, bitmap.empty() ? nullptr : bitmap.data(),
+                                       mask.empty() ? nullptr : mask.data());
+    std::cout << "🛠️ Admin " << action << " of " << rect.width << "x" << rect.height << " at " << rect.x << ","
+              << rect.y << " changed " << changed << " pixels" << std::endl;
+
+    ApiResponse response;
+    response.body = "{\"changed\":" + std::to_string(changed) +
+                    ",\"version\":" + std::to_string(core_.canvas().version()) + "}";
+    return response;
+}
+
+ApiResponse HttpApi::handleAttribution(const ApiRequest& request) {
+    if (request.method != "get") {
+        return getOnly();
+    }
+    CanvasRect rect{-1, -1, 1, 1};
+    if (!readParam(request.query, "x", rect.x) || !readParam(request.query, "y", rect.y) ||
+        !readParam(request.query, "w", rect.width) || !readParam(request.query, "h", rect.height)) {
+        return errorResponse("400 Bad Request", "bad number in region");
+    }
+    if (!rect.valid()) {
+        return errorResponse("400 Bad Request", "x and y are required and must be inside the canvas");
+    }
+
+    const AttributionPlane& attribution = core_.attribution();
+    ApiResponse response;
+    std::string& body = response.body;
+
+    // a single pixel: who wrote it last
+    if (rect.area() == 1) {
+        PixelOwner owner = attribution.at(rect.x, rect.y);
+        body = "{\"x\":" + std::to_string(rect.x) + ",\"y\":" + std::to_string(rect.y) + ",\"user\":";
+        appendJsonString(body, core_.users().text(owner.user));
+        body += ",\"address\":";
+        appendJsonString(body, core_.addresses().text(owner.address));
+        body += ",\"time\":" + std::to_string(owner.time) + "}";
+        return response;
+    }
+
+    // a region: everyone who painted in it, most pixels first
+    std::vector<RegionOwner> owners = attribution.summarize(rect);
+    body = "{\"owners\":" + std::to_string(owners.size()) + ",\"top\":[";
+    for (size_t i = 0; i < owners.size() && i < MAX_ATTRIBUTION_OWNERS; ++i) {
+        if (i > 0) {
+            body += ',';
+        }
+        body += "{\"user\":";
+        appendJsonString(body, core_.users().text(owners[i].user));
+        body += ",\"address\":";
+        appendJsonString(body, core_.addresses().text(owners[i].address));
+        body += ",\"pixels\":" + std::to_string(owners[i].pixels) +
+                ",\"last\":" + std::to_string(owners[i].last_time) + "}";
+    }
+    body += "]}";
+    return response;
+}
+
+ApiResponse HttpApi::handleRollback(const ApiRequest& request) {
+    if (request.method != "post") {
+        ApiResponse response = errorResponse("405 Method Not Allowed", "use POST");
+        response.headers.emplace_back("Allow", "POST");
+        return response;
+    }
+
+    RollbackFilter filter;
+    if (std::optional<std::string_view> user = queryValue(request.query, "user")) {
+        filter.by_user = true;
+        filter.user = core_.users().find(*user);
+        if (filter.user == UNKNOWN_ID) {
+            return errorResponse("404 Not Found", "unknown user");
+        }
+    }
+    if (std::optional<std::string_view> address = queryValue(request.query, "address")) {
+        filter.by_address = true;
+        filter.address = core_.addresses().find(*address);
+        if (filter.address == UNKNOWN_ID) {
+            return errorResponse("404 Not Found", "unknown address");
+        }
+    }
+    bool windowed = queryValue(request.query, "from") || queryValue(request.query, "to");
+    if (!readParam(request.query, "from", filter.from) || !readParam(request.query, "to", filter.to)) {
+        return errorResponse("400 Bad Request", "bad number in time window");
+    }
+    // an empty filter would revert everything in the history, ask for that explicitly
+    if (!filter.by_user && !filter.by_address && !windowed) {
+        return errorResponse("400 Bad Request", "give a user, an address or a from/to window");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ServerCore::RollbackResult result = core_.rollback(filter);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "⏪ Admin rollback reverted " << result.placements << " placements, " << result.changed
+              << " pixels changed in " << elapsed.count() << " us" << std::endl;
+
+    ApiResponse response;
+    response.body = "{\"placements\":" + std::to_string(result.placements) +
+                    ",\"changed\":" + std::to_string(result.changed) +
+                    ",\"version\":" + std::to_string(core_.canvas().version()) + "}";
+    return response;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class CanvasHistory;
+class ServerCore;
+
+// Transport independent view of an HTTP request, the views only live for the call
+struct ApiRequest {
+    std::string_view method; // lowercase, as uWS reports it
+    std::string_view url;    // path without the query
+    std::string_view query;  // everything after '?'
+    std::string_view authorization;
+    std::string_view if_none_match;
+    std::string_view range;
+    std::string_view body;
+};
+
+struct ApiResponse {
+    std::string status = "200 OK";
+    std::string content_type = "application/json";
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    // Cached payloads go out from here instead of body, without a copy per request.
+    // view points into shared, which keeps it alive while the transport writes it.
+    std::shared_ptr<const std::string> shared;
+    std::string_view view;
+
+    std::string_view payload() const { return shared ? view : std::string_view(body); }
+};
+
+// Returns the value of key in a query string like "x=1&y=2", nullopt when it is missing
+std::optional<std::string_view> queryValue(std::string_view query, std::string_view key);
+
+// HTTP endpoints next to the WebSocket. Admin routes need "Authorization: Bearer <token>"
+// and are disabled when no token is configured.
+//
+//   GET  /history?t=&format=bin|png  the canvas at unix time t, as raw bytes or a PNG
+//   GET  /tiles/{z}/{x}/{y}.png     spectator tiles of the live canvas, see CanvasPyramid
+//   GET  /canvas.png                the live canvas, encoded at most once per canvas version
+//   GET  /map.bin                   the raw canvas bytes of the current version, with Range support
+//   POST /admin/clear?x=&y=&w=&h=   clear a region, the whole canvas by default
+//   POST /admin/fill?x=&y=&w=&h=    paint a region, the whole canvas by default
+//   POST /admin/stamp?x=&y=&w=&h=   body is the packed region bitmap (rows back to back,
+//                                   LSB first), optionally followed by a mask of the same size
+//   GET  /admin/attribution?x=&y=   last writer and time of a pixel
+//   GET  /admin/attribution?x=&y=&w=&h=   painters in a region, most pixels first
+//   POST /admin/rollback?user=&address=&from=&to=   revert client placements, any combination
+//                                   of a name, an address and a unix time window
+class HttpApi {
+public:
+    // history may be null, its route is left out then
+    HttpApi(ServerCore& core, std::string admin_token, CanvasHistory* history = nullptr);
+
+    // nullopt when no route matches, so the transport keeps its own fallback
+    std::optional<ApiResponse> handle(const ApiRequest& request);
+
+    bool adminEnabled() const { return !admin_token_.empty(); }
+
+private:
+    bool authorized(std::string_view authorization) const;
+    ApiResponse handleHistory(const ApiRequest& request);
+    ApiResponse handleTile(std::string_view path, const ApiRequest& request);
+    ApiResponse handleCanvasPng(const ApiRequest& request);
+    ApiResponse handleMapBin(const ApiRequest& request);
+    ApiResponse handleAdmin(std::string_view action, const ApiRequest& request);
+    ApiResponse handleAttribution(const ApiRequest& request);
+    ApiResponse handleRollback(const ApiRequest& request);
+
+    ServerCore& core_;
+    std::string admin_token_;
+    CanvasHistory* history_;
+    // Part of every ETag, so tags from before a restart never match
+    std::string etag_epoch_;
+
+    // Immutable once built, a new version gets a new string so responses in flight keep theirs
+    std::shared_ptr<const std::string> canvas_png_;
+    uint64_t canvas_png_version_ = UINT64_MAX;
+    std::shared_ptr<const std::string> snapshot_;
+    uint64_t snapshot_version_ = UINT64_MAX;
+};
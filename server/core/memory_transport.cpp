@@ -0,0 +1,63 @@
+#include "memory_transport.h"
+
+#include <algorithm>
+
+#include "server_core.h"
+
+MemoryConnection::MemoryConnection(ServerCore& core, std::string address)
+    : core_(core), address_(std::move(address)) {}
+
+MemoryConnection::~MemoryConnection() {
+    close();
+}
+
+bool MemoryConnection::open() {
+    open_ = true;
+    if (!core_.onOpen(this)) {
+        open_ = false;
+        return false;
+    }
+    return true;
+}
+
+void MemoryConnection::receive(std::string_view message) {
+    if (open_) {
+        core_.onMessage(this, message);
+    }
+}
+
+void MemoryConnection::send(std::string_view message, bool /*binary*/) {
+    if (!open_) {
+        return;
+    }
+    sent_messages++;
+    sent_bytes += message.size();
+    if (keep_messages) {
+        outbox.emplace_back(message);
+    }
+}
+
+void MemoryConnection::close() {
+    if (!open_) {
+        return;
+    }
+    open_ = false;
+    core_.onClose(this);
+}
+
+MemoryConnection* MemoryTransport::connect(const std::string& address) {
+    auto connection = std::make_unique<MemoryConnection>(core_, address);
+    if (!connection->open()) {
+        return nullptr;
+    }
+    connections_.push_back(std::move(connection));
+    return connections_.back().get();
+}
+
+void MemoryTransport::disconnect(MemoryConnection* connection) {
+    auto it = std::find_if(connections_.begin(), connections_.end(),
+                           [connection](const auto& owned) { return owned.get() == connection; });
+    if (it != connections_.end()) {
+        connections_.erase(it); // destructor closes the connection
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "connection.h"
+
+class ServerCore;
+
+// A connection living entirely in memory, drives ServerCore without any sockets
+class MemoryConnection : public Connection {
+public:
+    MemoryConnection(ServerCore& core, std::string address);
+    ~MemoryConnection() override;
+
+    bool open();
+    // Deliver a message from the client to the server
+    void receive(std::string_view message);
+    bool isOpen() const { return open_; }
+
+    void send(std::string_view message, bool binary = false) override;
+    void close() override;
+    std::string_view remoteAddress() const override { return address_; }
+    size_t bufferedAmount() const override { return buffered_bytes; }
+
+    // Messages sent by the server, only recorded when keep_messages is set
+    std::vector<std::string> outbox;
+    bool keep_messages = true;
+    size_t sent_messages = 0;
+    size_t sent_bytes = 0;
+    // Simulated send buffer, lets simulations put load on the server
+    size_t buffered_bytes = 0;
+
+private:
+    ServerCore& core_;
+    std::string address_;
+    bool open_ = false;
+};
+
+// Owns a set of in-memory connections to one ServerCore
+class MemoryTransport {
+public:
+    explicit MemoryTransport(ServerCore& core) : core_(core) {}
+
+    // Returns nullptr when the server refused the connection
+    MemoryConnection* connect(const std::string& address = "127.0.0.1");
+    void disconnect(MemoryConnection* connection);
+
+    const std::vector<std::unique_ptr<MemoryConnection>>& connections() const { return connections_; }
+
+private:
+    ServerCore& core_;
+    std::vector<std::unique_ptr<MemoryConnection>> connections_;
+};
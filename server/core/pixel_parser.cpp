@@ -0,0 +1,168 @@
+#include "pixel_parser.h"
+
+#include <charconv>
+
+namespace {
+
+// Reads a plain decimal number from the front of text and advances past it
+std::expected<uint32_t, PixelParseError> readNumber(std::string_view& text) {
+    // from_chars already rejects '-' for unsigned types, checking for a digit
+    // first also keeps out '+' and whitespace
+    if (text.empty() || text.front() < '0' || text.front() > '9') {
+        return std::unexpected(PixelParseError::BadNumber);
+    }
+    uint32_t value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc()) {
+        return std::unexpected(PixelParseError::BadNumber);
+    }
+    text.remove_prefix(end - text.data());
+    return value;
+}
+
+// Reads "<prefix><digits>" from the front of text and advances past it
+std::expected<uint32_t, PixelParseError> readField(std::string_view& text, std::string_view prefix) {
+    if (!text.starts_with(prefix)) {
+        return std::unexpected(PixelParseError::BadFormat);
+    }
+    text.remove_prefix(prefix.size());
+    return readNumber(text);
+}
+
+// Reads count numbers separated by ',' into values
+std::expected<void, PixelParseError> readNumbers(std::string_view& text, uint32_t* values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            if (!text.starts_with(',')) {
+                return std::unexpected(PixelParseError::BadFormat);
+            }
+            text.remove_prefix(1);
+        }
+        auto value = readNumber(text);
+        if (!value) {
+            return std::unexpected(value.error());
+        }
+        values[i] = *value;
+    }
+    return {};
+}
+
+std::expected<bool, PixelParseError> toColor(uint32_t color) {
+    if (color > 1) {
+        return std::unexpected(PixelParseError::BadColor);
+    }
+    return color == 1;
+}
+
+// The area [x, x + width) x [y, y + height) must lie on the canvas
+bool inCanvas(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    return width > 0 && height > 0 && x < uint32_t(CANVAS_WIDTH) && y < uint32_t(CANVAS_HEIGHT) &&
+           width <= uint32_t(CANVAS_WIDTH) - x && height <= uint32_t(CANVAS_HEIGHT) - y;
+}
+
+} // namespace
+
+std::expected<PixelUpdate, PixelParseError> parsePixel(std::string_view payload) {
+    auto x = readField(payload, "x:");
+    if (!x) {
+        return std::unexpected(x.error());
+    }
+    auto y = readField(payload, ",y:");
+    if (!y) {
+        return std::unexpected(y.error());
+    }
+    auto color = readField(payload, ",c:");
+    if (!color) {
+        return std::unexpected(color.error());
+    }
+    if (!payload.empty()) {
+        return std::unexpected(PixelParseError::BadFormat);
+    }
+
+    if (*x >= uint32_t(CANVAS_WIDTH) || *y >= uint32_t(CANVAS_HEIGHT)) {
+        return std::unexpected(PixelParseError::OutOfRange);
+    }
+    if (*color > 1) {
+        return std::unexpected(PixelParseError::BadColor);
+    }
+    return PixelUpdate{uint16_t(*x), uint16_t(*y), *color == 1};
+}
+
+std::expected<PixelBatch, PixelParseError> parsePixelBatch(std::string_view payload) {
+    PixelBatch batch{};
+    uint32_t values[5];
+
+    if (payload.starts_with("r:") || payload.starts_with("b:")) {
+        batch.shape = payload.front() == 'r' ? BatchShape::Run : BatchShape::Rect;
+        payload.remove_prefix(2);
+
+        // x, y, width, [height,] color
+        size_t count = batch.shape == BatchShape::Run ? 4 : 5;
+        if (auto read = readNumbers(payload, values, count); !read) {
+            return std::unexpected(read.error());
+        }
+        if (!payload.empty()) {
+            return std::unexpected(PixelParseError::BadFormat);
+        }
+        uint32_t height = batch.shape == BatchShape::Run ? 1 : values[3];
+        if (!inCanvas(values[0], values[1], values[2], height)) {
+            return std::unexpected(PixelParseError::OutOfRange);
+        }
+        auto color = toColor(values[count - 1]);
+        if (!color) {
+            return std::unexpected(color.error());
+        }
+        batch.x = uint16_t(values[0]);
+        batch.y = uint16_t(values[1]);
+        batch.width = uint16_t(values[2]);
+        batch.height = uint16_t(height);
+        batch.color = *color;
+        return batch;
+    }
+
+    auto color_value = readField(payload, "l:");
+    if (!color_value) {
+        return std::unexpected(color_value.error());
+    }
+    auto color = toColor(*color_value);
+    if (!color) {
+        return std::unexpected(color.error());
+    }
+    batch.shape = BatchShape::List;
+    batch.color = *color;
+
+    // ":x,y;x,y;..."
+    char separator = ':';
+    while (!payload.empty()) {
+        if (payload.front() != separator || batch.count == MAX_BATCH_POINTS) {
+            return std::unexpected(PixelParseError::BadFormat);
+        }
+        payload.remove_prefix(1);
+        separator = ';';
+        if (auto read = readNumbers(payload, values, 2); !read) {
+            return std::unexpected(read.error());
+        }
+        if (!inCanvas(values[0], values[1], 1, 1)) {
+            return std::unexpected(PixelParseError::OutOfRange);
+        }
+        batch.points[batch.count++] = {uint16_t(values[0]), uint16_t(values[1])};
+    }
+    if (batch.count == 0) {
+        return std::unexpected(PixelParseError::BadFormat);
+    }
+    return batch;
+}
+
+const char* describePixelParseError(PixelParseError error) {
+    switch (error) {
+    case PixelParseError::BadFormat:
+        return "invalid pixel update format";
+    case PixelParseError::BadNumber:
+        return "invalid number";
+    case PixelParseError::OutOfRange:
+        return "invalid pixel coordinates";
+    case PixelParseError::BadColor:
+        return "invalid color value";
+    }
+    return "unknown error";
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <string_view>
+
+#include "canvas_kernels.h"
+#include "config.h"
+
+struct PixelUpdate {
+    uint16_t x;
+    uint16_t y;
+    bool color;
+};
+
+enum class BatchShape : uint8_t {
+    Run,  // "r:x,y,length,c", horizontal run starting at (x, y)
+    Rect, // "b:x,y,width,height,c", filled box
+    List, // "l:c:x,y;x,y;...", up to MAX_BATCH_POINTS coordinates
+};
+
+// Payload of a [PIXELS] frame, a whole stroke or shape in one message
+struct PixelBatch {
+    BatchShape shape;
+    bool color;
+    uint16_t x, y, width, height; // Run and Rect, a run has height 1
+    uint8_t count;                // List
+    std::array<CanvasPoint, MAX_BATCH_POINTS> points;
+
+    uint32_t pixelCount() const { return shape == BatchShape::List ? count : uint32_t(width) * height; }
+};
+
+enum class PixelParseError : uint8_t {
+    BadFormat,  // missing or misplaced x:, ,y: or ,c: fields, or trailing data
+    BadNumber,  // empty, signed, non-digit or overflowing number
+    OutOfRange, // coordinates outside the canvas
+    BadColor,   // color other than 0 or 1
+};
+
+// Parse the payload of a [PIXEL] frame, "x:<x>,y:<y>,c:<0|1>".
+// Never throws and never allocates, errors are returned as values.
+std::expected<PixelUpdate, PixelParseError> parsePixel(std::string_view payload);
+
+// Parse the payload of a [PIXELS] frame, same rules as parsePixel
+std::expected<PixelBatch, PixelParseError> parsePixelBatch(std::string_view payload);
+
+const char* describePixelParseError(PixelParseError error);
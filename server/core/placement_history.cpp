@@ -0,0 +1,119 @@
+#include "placement_history.h"
+
+#include <algorithm>
+
+#include "config.h"
+
+PlacementHistory::PlacementHistory(size_t capacity)
+    : ring_(std::max<size_t>(capacity, 1)),
+      pixel_head_(size_t(CANVAS_WIDTH) * CANVAS_HEIGHT, 0),
+      user_head_(size_t(UINT16_MAX) + 1, 0),
+      address_head_(size_t(UINT16_MAX) + 1, 0),
+      touched_bits_((size_t(CANVAS_WIDTH) * CANVAS_HEIGHT + 63) / 64, 0) {}
+
+void PlacementHistory::record(uint32_t pixel, bool previous_color, bool color, const PixelOwner& owner) {
+    uint32_t sequence = next_++;
+    Placement& placement = at(sequence);
+    placement.time = owner.time;
+    placement.pixel = pixel | (color ? COLOR_FLAG : 0) | (previous_color ? PREVIOUS_FLAG : 0);
+    placement.prev_pixel = pixel_head_[pixel];
+    placement.prev_user = user_head_[owner.user];
+    placement.prev_address = address_head_[owner.address];
+    placement.user = owner.user;
+    placement.address = owner.address;
+
+    pixel_head_[pixel] = sequence;
+    user_head_[owner.user] = sequence;
+    address_head_[owner.address] = sequence;
+}
+
+void PlacementHistory::sealRect(const CanvasRect& rect) {
+    if (!rect.valid()) {
+        return;
+    }
+    for (int y = rect.y; y < rect.y + rect.height; ++y) {
+        auto row = pixel_head_.begin() + size_t(y) * CANVAS_WIDTH + rect.x;
+        std::fill(row, row + rect.width, 0);
+    }
+}
+
+bool PlacementHistory::matches(const Placement& placement, const RollbackFilter& filter) const {
+    return !(placement.pixel & REVERTED_FLAG) && (!filter.by_user || placement.user == filter.user) &&
+           (!filter.by_address || placement.address == filter.address) && placement.time >= filter.from &&
+           placement.time <= filter.to;
+}
+
+void PlacementHistory::touch(uint32_t pixel, std::vector<uint32_t>& touched) {
+    uint64_t bit = uint64_t(1) << (pixel % 64);
+    if (!(touched_bits_[pixel / 64] & bit)) {
+        touched_bits_[pixel / 64] |= bit;
+        touched.push_back(pixel);
+    }
+}
+
+size_t PlacementHistory::rollback(const RollbackFilter& filter, std::vector<Revert>& reverts) {
+    std::vector<uint32_t> touched;
+    size_t reverted = 0;
+    auto revert = [&](Placement& placement) {
+        placement.pixel |= REVERTED_FLAG;
+        touch(placement.pixel & PIXEL_MASK, touched);
+        reverted++;
+    };
+
+    // Collect the matching placements, through the shortest index that covers the filter
+    if (filter.by_user || filter.by_address) {
+        uint32_t sequence = filter.by_user ? user_head_[filter.user] : address_head_[filter.address];
+        while (valid(sequence)) {
+            Placement& placement = at(sequence);
+            // chains run newest first, nothing older can be inside the window
+            if (placement.time < filter.from) {
+                break;
+            }
+            if (matches(placement, filter)) {
+                revert(placement);
+            }
+            sequence = filter.by_user ? placement.prev_user : placement.prev_address;
+        }
+    } else {
+        // the ring is in time order, find the start of the window by bisection
+        uint32_t low = next_ - uint32_t(size()), high = next_;
+        while (low < high) {
+            uint32_t middle = low + (high - low) / 2;
+            if (at(middle).time < filter.from) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        for (uint32_t sequence = low; sequence < next_ && at(sequence).time <= filter.to; ++sequence) {
+            if (matches(at(sequence), filter)) {
+                revert(at(sequence));
+            }
+        }
+    }
+
+    // Every touched pixel gets the color of its newest placement that was not reverted,
+    // or the value from before the oldest one in its chain
+    for (uint32_t pixel : touched) {
+        touched_bits_[pixel / 64] &= ~(uint64_t(1) << (pixel % 64));
+
+        uint32_t sequence = pixel_head_[pixel];
+        if (!valid(sequence) || !(at(sequence).pixel & REVERTED_FLAG)) {
+            // sealed, or the newest placement stays
+            continue;
+        }
+        Revert result{pixel, false, {}};
+        while (valid(sequence)) {
+            const Placement& placement = at(sequence);
+            if (!(placement.pixel & REVERTED_FLAG)) {
+                result.color = placement.pixel & COLOR_FLAG;
+                result.owner = {placement.time, placement.user, placement.address};
+                break;
+            }
+            result.color = placement.pixel & PREVIOUS_FLAG;
+            sequence = placement.prev_pixel;
+        }
+        reverts.push_back(result);
+    }
+    return reverted;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "attribution.h"
+#include "canvas_kernels.h"
+
+// Which placements to revert, all given conditions must match
+struct RollbackFilter {
+    bool by_user = false;
+    InternId user = UNKNOWN_ID;
+    bool by_address = false;
+    InternId address = UNKNOWN_ID;
+    uint32_t from = 0; // unix seconds, inclusive
+    uint32_t to = UINT32_MAX;
+};
+
+// A pixel a rollback changes, and the placement that now owns it (empty when it went
+// back to a value from before the history)
+struct Revert {
+    uint32_t pixel; // y * CANVAS_WIDTH + x
+    bool color;
+    PixelOwner owner;
+};
+
+// The last `capacity` client placements in a ring, indexed by sequence number. Every placement
+// links to the previous one of the same pixel, user and address, so a rollback only visits
+// the placements it is about, and per pixel chains tell what value survives.
+class PlacementHistory {
+public:
+    explicit PlacementHistory(size_t capacity);
+
+    void record(uint32_t pixel, bool previous_color, bool color, const PixelOwner& owner);
+    // Cut the history of a pixel, e.g. after an admin overwrote it, so rollbacks never reach behind it
+    void seal(uint32_t pixel) { pixel_head_[pixel] = 0; }
+    void sealRect(const CanvasRect& rect);
+
+    // Marks the matching placements as reverted and fills reverts with the pixels whose value
+    // comes from somewhere else now. Returns the number of reverted placements.
+    size_t rollback(const RollbackFilter& filter, std::vector<Revert>& reverts);
+
+    size_t size() const { return std::min<size_t>(next_ - 1, ring_.size()); }
+
+private:
+    // Pixel indices stay below 2^18, the flags live above
+    static constexpr uint32_t PIXEL_MASK = (1u << 24) - 1;
+    static constexpr uint32_t COLOR_FLAG = 1u << 31;
+    static constexpr uint32_t PREVIOUS_FLAG = 1u << 30;
+    static constexpr uint32_t REVERTED_FLAG = 1u << 29;
+
+    // 24 bytes, sequence 0 means none
+    struct Placement {
+        uint32_t time;
+        uint32_t pixel; // index plus flags
+        uint32_t prev_pixel;
+        uint32_t prev_user;
+        uint32_t prev_address;
+        InternId user;
+        InternId address;
+    };
+
+    bool valid(uint32_t sequence) const {
+        return sequence != 0 && sequence < next_ && next_ - sequence <= ring_.size();
+    }
+    Placement& at(uint32_t sequence) { return ring_[sequence % ring_.size()]; }
+    bool matches(const Placement& placement, const RollbackFilter& filter) const;
+    void touch(uint32_t pixel, std::vector<uint32_t>& touched);
+
+    std::vector<Placement> ring_;
+    // Newest placement per pixel, per user and per address
+    std::vector<uint32_t> pixel_head_;
+    std::vector<uint32_t> user_head_;
+    std::vector<uint32_t> address_head_;
+    // Pixels already collected by the running rollback, one bit each
+    std::vector<uint64_t> touched_bits_;
+    // 32 bits of sequence last for years at the rates the rate limiter allows
+    uint32_t next_ = 1;
+};
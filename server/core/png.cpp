@@ -0,0 +1,76 @@
+#include "png.h"
+
+#include <algorithm>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+
+void appendUint32(std::string& out, uint32_t value) {
+    out += char(value >> 24);
+    out += char(value >> 16);
+    out += char(value >> 8);
+    out += char(value);
+}
+
+// length, type, data, then the CRC over type and data
+void appendChunk(std::string& out, const char* type, const uint8_t* data, size_t size) {
+    appendUint32(out, uint32_t(size));
+    size_t crc_start = out.size();
+    out.append(type, 4);
+    out.append(reinterpret_cast<const char*>(data), size);
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(out.data() + crc_start), uInt(size + 4));
+    appendUint32(out, uint32_t(crc));
+}
+
+// rows holds height filtered scanlines (a filter byte each), bit depth and color type as in IHDR
+std::string encodePng(const std::vector<uint8_t>& rows, int width, int height, uint8_t bit_depth,
+                      uint8_t color_type, const uint8_t* palette, size_t palette_size) {
+    uLongf compressed_size = compressBound(rows.size());
+    std::vector<uint8_t> compressed(compressed_size);
+    if (compress2(compressed.data(), &compressed_size, rows.data(), rows.size(), Z_BEST_SPEED) != Z_OK) {
+        return {};
+    }
+
+    std::string png = "\x89PNG\r\n\x1a\n";
+    uint8_t header[13] = {
+        uint8_t(width >> 24), uint8_t(width >> 16), uint8_t(width >> 8), uint8_t(width),
+        uint8_t(height >> 24), uint8_t(height >> 16), uint8_t(height >> 8), uint8_t(height),
+        bit_depth, color_type, 0, 0, 0, // deflate, adaptive filtering, no interlace
+    };
+    appendChunk(png, "IHDR", header, sizeof(header));
+    if (palette) {
+        appendChunk(png, "PLTE", palette, palette_size);
+    }
+    appendChunk(png, "IDAT", compressed.data(), compressed_size);
+    appendChunk(png, "IEND", nullptr, 0);
+    return png;
+}
+
+} // namespace
+
+std::string encodeBitmapPng(const uint8_t* bits, int width, int height) {
+    // PNG rows start on a byte and keep the leftmost pixel in the high bit
+    size_t row_bytes = (size_t(width) + 7) / 8;
+    std::vector<uint8_t> rows((row_bytes + 1) * height, 0);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = &rows[(row_bytes + 1) * y + 1];
+        size_t bit = size_t(y) * width;
+        for (int x = 0; x < width; ++x, ++bit) {
+            if (bits[bit / 8] & (1 << (bit % 8))) {
+                row[x / 8] |= uint8_t(0x80 >> (x % 8));
+            }
+        }
+    }
+    // index 0 white, index 1 black
+    static const uint8_t PALETTE[] = {0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00};
+    return encodePng(rows, width, height, 1, 3, PALETTE, sizeof(PALETTE));
+}
+
+std::string encodeGrayPng(const uint8_t* pixels, int width, int height) {
+    std::vector<uint8_t> rows((size_t(width) + 1) * height, 0);
+    for (int y = 0; y < height; ++y) {
+        std::copy(pixels + size_t(y) * width, pixels + size_t(y + 1) * width, &rows[(size_t(width) + 1) * y + 1]);
+    }
+    return encodePng(rows, width, height, 8, 0, nullptr, 0);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Encodes width * height canvas bits (row-major, rows back to back, LSB first) as a 1-bit
+// indexed PNG, unpainted white and painted black. Empty on failure.
+std::string encodeBitmapPng(const uint8_t* bits, int width, int height);
+// Encodes width * height 8-bit gray pixels (row-major, 0 black) as a grayscale PNG
+std::string encodeGrayPng(const uint8_t* pixels, int width, int height);
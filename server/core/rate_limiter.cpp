@@ -0,0 +1,150 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace {
+
+uint64_t hashAddress(std::string_view address) {
+    // FNV-1a followed by a splitmix finalizer to spread the bits over shard and slot
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : address) {
+        hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+    return hash ? hash : 1;
+}
+
+int64_t toMilliseconds(RateLimiter::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+RateLimiter::RateLimiter(size_t max_addresses) {
+    buckets_[size_t(Budget::Pixel)] = {PIXEL_BURST, PIXEL_PLACE_TIMEOUT};
+    buckets_[size_t(Budget::Stroke)] = {STROKE_BURST, STROKE_REFILL_INTERVAL};
+    buckets_[size_t(Budget::Sync)] = {SYNC_BURST, SYNC_REFILL_INTERVAL};
+    buckets_[size_t(Budget::Repair)] = {REPAIR_BURST, REPAIR_REFILL_INTERVAL};
+    updateExpiry();
+
+    size_t per_shard = std::bit_ceil(std::max<size_t>(max_addresses / SHARD_COUNT, PROBE_LIMIT));
+    slot_mask_ = per_shard - 1;
+    shards_ = std::make_unique<Shard[]>(SHARD_COUNT);
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        shards_[i].entries.resize(per_shard);
+    }
+}
+
+void RateLimiter::configure(Budget budget, float capacity, uint32_t refill_interval_ms) {
+    buckets_[size_t(budget)] = {capacity, std::max<uint32_t>(refill_interval_ms, 1)};
+    updateExpiry();
+}
+
+void RateLimiter::updateExpiry() {
+    expiry_ms_ = 0;
+    for (const auto& bucket : buckets_) {
+        expiry_ms_ = std::max(expiry_ms_, int64_t(bucket.capacity * bucket.refill_interval_ms));
+    }
+}
+
+RateDecision RateLimiter::tryConsume(std::string_view address, Budget budget, Clock::time_point now, float cost) {
+    Charge charge{budget, cost};
+    return tryConsume(address, std::span(&charge, 1), now);
+}
+
+RateDecision RateLimiter::tryConsume(std::string_view address, std::span<const Charge> charges, Clock::time_point now) {
+    uint64_t key = hashAddress(address);
+    int64_t now_ms = toMilliseconds(now);
+    Shard& shard = shards_[key >> 60]; // top 4 bits pick one of the 16 shards
+
+    std::lock_guard lock(shard.mutex);
+    Entry& entry = findOrInsert(shard, key, now_ms);
+    refill(entry, now_ms);
+
+    uint32_t wait = 0;
+    for (const Charge& charge : charges) {
+        float tokens = entry.tokens[size_t(charge.budget)];
+        if (tokens < charge.cost) {
+            const BucketConfig& config = buckets_[size_t(charge.budget)];
+            // a cost above the capacity can never be paid
+            uint32_t needed = charge.cost > config.capacity ? UINT32_MAX
+                : uint32_t((charge.cost - tokens) * config.refill_interval_ms) + 1;
+            wait = std::max(wait, needed);
+        }
+    }
+    if (wait > 0) {
+        return {false, wait};
+    }
+    for (const Charge& charge : charges) {
+        entry.tokens[size_t(charge.budget)] -= charge.cost;
+    }
+    return {true, 0};
+}
+
+size_t RateLimiter::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        std::lock_guard lock(shards_[i].mutex);
+        total += shards_[i].used;
+    }
+    return total;
+}
+
+RateLimiter::Entry& RateLimiter::findOrInsert(Shard& shard, uint64_t key, int64_t now_ms) {
+    size_t start = key & slot_mask_;
+    Entry* reusable = nullptr;
+    Entry* oldest = nullptr;
+
+    for (size_t probe = 0; probe < PROBE_LIMIT; ++probe) {
+        Entry& entry = shard.entries[(start + probe) & slot_mask_];
+        if (entry.key == key) {
+            return entry;
+        }
+        if (entry.key == 0) {
+            // entries are never removed, so the key can't be further along
+            if (!reusable) {
+                reusable = &entry;
+            }
+            break;
+        }
+        if (!reusable && now_ms - entry.last_ms >= expiry_ms_) {
+            reusable = &entry; // forgetting it changes nothing, its buckets are full again
+        }
+        if (!oldest || entry.last_ms < oldest->last_ms) {
+            oldest = &entry;
+        }
+    }
+
+    Entry& slot = reusable ? *reusable : *oldest;
+    if (slot.key == 0) {
+        shard.used++;
+    }
+    slot.key = key;
+    fill(slot, now_ms);
+    return slot;
+}
+
+void RateLimiter::refill(Entry& entry, int64_t now_ms) const {
+    int64_t elapsed = now_ms - entry.last_ms;
+    if (elapsed <= 0) {
+        return;
+    }
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        const BucketConfig& config = buckets_[i];
+        entry.tokens[i] = std::min(config.capacity, entry.tokens[i] + float(elapsed) / config.refill_interval_ms);
+    }
+    entry.last_ms = now_ms;
+}
+
+void RateLimiter::fill(Entry& entry, int64_t now_ms) const {
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        entry.tokens[i] = buckets_[i].capacity;
+    }
+    entry.last_ms = now_ms;
+}
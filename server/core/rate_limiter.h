@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "config.h"
+
+// Independent token buckets every address has
+enum class Budget : uint8_t {
+    Pixel,  // pixel placements, one token per [PIXEL] or [PIXELS] frame
+    Stroke, // pixels placed through [PIXELS] batches, one token per pixel
+    Sync,   // full canvas syncs
+    Repair, // canvas data fetched in parts, one token per tile's worth
+    Count
+};
+
+struct Charge {
+    Budget budget;
+    float cost;
+};
+
+struct RateDecision {
+    bool allowed;
+    uint32_t retry_after_ms; // time until the request would be allowed, 0 when allowed
+};
+
+// Per-address token buckets shared by every connection from that address, so
+// reconnecting does not reset a cooldown. Memory is fixed: a sharded open addressing
+// table where idle entries expire and the least recently seen one is evicted when full.
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RateLimiter(size_t max_addresses = RATE_LIMIT_ADDRESSES);
+
+    // Takes cost tokens from the budget of the address if it has enough
+    RateDecision tryConsume(std::string_view address, Budget budget, Clock::time_point now, float cost = 1);
+    // Takes all charges or none of them
+    RateDecision tryConsume(std::string_view address, std::span<const Charge> charges, Clock::time_point now);
+
+    // Change a budget at runtime, e.g. when the cooldown follows the server load
+    void configure(Budget budget, float capacity, uint32_t refill_interval_ms);
+
+    size_t size() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr size_t PROBE_LIMIT = 16;
+
+    struct Entry {
+        uint64_t key = 0; // 0 marks a slot that was never used
+        int64_t last_ms = 0; // last refill, all buckets of an entry are refilled together
+        std::array<float, size_t(Budget::Count)> tokens{};
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<Entry> entries;
+        size_t used = 0;
+    };
+
+    struct BucketConfig {
+        float capacity;
+        uint32_t refill_interval_ms; // time to regain one token
+    };
+
+    Entry& findOrInsert(Shard& shard, uint64_t key, int64_t now_ms);
+    void refill(Entry& entry, int64_t now_ms) const;
+    void fill(Entry& entry, int64_t now_ms) const;
+    void updateExpiry();
+
+    std::array<BucketConfig, size_t(Budget::Count)> buckets_;
+    int64_t expiry_ms_ = 0; // idle time after which every bucket of an entry is full again
+    std::unique_ptr<Shard[]> shards_;
+    size_t slot_mask_ = 0;
+};
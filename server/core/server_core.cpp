@@ -0,0 +1,636 @@
+#include "server_core.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+
+#include "pixel_parser.h"
+
+std::string getClientName(const Connection* connection) {
+    std::string client_name = connection->session.flipper_name;
+    if (client_name.empty()) {
+        client_name = "Unknown";
+    }
+    return client_name;
+}
+
+namespace {
+
+uint32_t unixSeconds() {
+    return uint32_t(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Parse the whole of text as a decimal number
+template <typename T>
+bool parseNumber(std::string_view text, T& value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+// The top row of the client's view, "y" in [MAP/SYNC:y]
+bool parseViewRow(std::string_view text, int& view_y) {
+    int y = 0;
+    if (!parseNumber(text, y) || y < 0 || y >= CANVAS_HEIGHT) {
+        return false;
+    }
+    view_y = y;
+    return true;
+}
+
+} // namespace
+
+ServerCore::ServerCore(Canvas& canvas) : canvas_(canvas) {}
+
+PixelOwner ServerCore::ownerOf(const Connection* connection) const {
+    return {unixSeconds(), connection->session.user_id, connection->session.address_id};
+}
+
+void ServerCore::recordPlacement(int x, int y, bool color, const PixelOwner& owner) {
+    attribution_.record(x, y, owner);
+    history_.record(uint32_t(y) * CANVAS_WIDTH + uint32_t(x), canvas_.getPixel(x, y), color, owner);
+}
+
+Admission ServerCore::checkAdmission(const std::string& address) {
+    return admission_.check(address, now_());
+}
+
+bool ServerCore::onOpen(Connection* connection) {
+    std::string address(connection->remoteAddress());
+
+    // normally already checked before the handshake, but not every transport has one
+    Admission admission = admission_.check(address, now_());
+    if (admission != Admission::Accepted) {
+        std::cout << "Refusing client " << address << ": " << describeAdmission(admission) << std::endl;
+        connection->close();
+        return false;
+    }
+    admission_.add(address);
+    connection->session.admitted = true;
+    connection->session.address_id = addresses_.intern(address);
+
+    // get the time to print when the client connected
+    auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::cout << std::ctime(&time) << "New client connected, addr: " << address << std::endl;
+
+    clients_.push_back(connection);
+
+    // Send a wake with all needed information like, canvas size, timeout time, payload size, etc
+    std::string wake = "[WAKE:cw:" + std::to_string(CANVAS_WIDTH) + ":ch:" + std::to_string(CANVAS_HEIGHT) +
+        ":t:" + std::to_string(cooldown_.timeout()) + ":ps:" + std::to_string(MAX_PAYLOAD_SIZE) + "]";
+    connection->send(wake);
+    return true;
+}
+
+// Indexed by Command
+const ServerCore::CommandHandler ServerCore::COMMAND_HANDLERS[] = {
+    &ServerCore::handleUnknown,     // Command::Unknown
+    &ServerCore::handleStop,        // Command::Stop
+    &ServerCore::handleMapSync,     // Command::MapSync
+    &ServerCore::handleName,        // Command::Name
+    &ServerCore::handlePixel,       // Command::Pixel
+    &ServerCore::handlePixels,      // Command::Pixels
+    &ServerCore::handleMapOverview, // Command::MapOverview
+    &ServerCore::handleMapHash,     // Command::MapHash
+    &ServerCore::handleMapTile,     // Command::MapTile
+    &ServerCore::handleMapResume,   // Command::MapResume
+};
+
+void ServerCore::onMessage(Connection* connection, std::string_view message) {
+    // when message is long don't process it
+    if (message.size() > MAX_MESSAGE_LENGTH) {
+        std::cout << "Received long message, ignoring" << std::endl;
+        return;
+    }
+
+    static_assert(std::size(COMMAND_HANDLERS) == size_t(Command::Count), "Every Command needs a handler");
+
+    ParsedCommand parsed = parseCommand(message);
+    (this->*COMMAND_HANDLERS[size_t(parsed.command)])(connection, parsed);
+}
+
+void ServerCore::handleUnknown(Connection* /*connection*/, const ParsedCommand& command) {
+    std::cout << "Received message: " << command.message << std::endl;
+}
+
+void ServerCore::handleStop(Connection* connection, const ParsedCommand& /*command*/) {
+    std::cout << "Received STOP command, closing connection" << std::endl;
+    connection->close();
+}
+
+bool ServerCore::charge(Connection* connection, Budget budget, float cost) {
+    RateDecision decision = rate_limiter_.tryConsume(connection->remoteAddress(), budget, now_(), cost);
+    if (decision.allowed) {
+        return true;
+    }
+    // "[MAP/RETRY:seconds]", the client asks again once the budget has refilled
+    uint32_t seconds = (decision.retry_after_ms + 999) / 1000;
+    std::cout << (budget == Budget::Sync ? "Sync" : "Repair") << " budget of " << connection->remoteAddress()
+              << " exhausted, retry in " << seconds << " s" << std::endl;
+    connection->send("[MAP/RETRY:" + std::to_string(seconds) + "]");
+    return false;
+}
+
+void ServerCore::handleMapSync(Connection* connection, const ParsedCommand& command) {
+    std::cout << "Client requested canvas sync" << std::endl;
+    if (!charge(connection, Budget::Sync)) {
+        return;
+    }
+    // "[MAP/SYNC:y]" moves the view the sync starts at
+    if (!command.argument.empty() && !parseViewRow(command.argument, connection->session.view_y)) {
+        std::cout << "Invalid sync view received: " << command.message << std::endl;
+    }
+    startSync(connection);
+}
+
+void ServerCore::handleName(Connection* connection, const ParsedCommand& command) {
+    // Set flipper name
+    std::string new_name(command.payload);
+
+    new_name.erase(std::remove_if(new_name.begin(), new_name.end(), ::isspace), new_name.end());
+    if (new_name.size() > 10) {
+        new_name = new_name.substr(0, 10);
+    }
+    if (new_name.empty()) {
+        std::cout << "Invalid name received, ignoring" << std::endl;
+        return;
+    }
+
+    connection->session.flipper_name = new_name;
+    connection->session.user_id = users_.intern(new_name);
+    std::cout << "Client set name to: " << new_name << std::endl;
+
+    // "[NAME:rate:y]name", a client on a slow link tells how many bytes per second it takes
+    // and where it looks, so its sync is paced and starts with what is on its screen
+    connection->session.link_rate = 0;
+    if (!command.argument.empty()) {
+        std::string_view argument = command.argument;
+        size_t colon = argument.find(':');
+        uint32_t rate = 0;
+        if (colon != std::string_view::npos && parseNumber(argument.substr(0, colon), rate) &&
+            parseViewRow(argument.substr(colon + 1), connection->session.view_y)) {
+            connection->session.link_rate = std::max<uint32_t>(rate, MIN_LINK_RATE);
+        } else {
+            std::cout << "Invalid link received, syncing at full speed: " << command.message << std::endl;
+        }
+    }
+
+    // named clients may use the reserved slots when they reconnect
+    admission_.rememberNamed(std::string(connection->remoteAddress()), now_());
+
+    // Send initial canvas state, unless the client repairs a cached one
+    if (connection->session.resumed) {
+        return;
+    }
+    if (!charge(connection, Budget::Sync)) {
+        return;
+    }
+    startSync(connection);
+}
+
+void ServerCore::handlePixel(Connection* connection, const ParsedCommand& command) {
+    auto pixel = parsePixel(command.payload);
+    if (!pixel) {
+        std::cout << "Ignoring pixel update, " << describePixelParseError(pixel.error()) << ": "
+                  << command.message << std::endl;
+        return;
+    }
+
+    // the cooldown is kept per address, so reconnecting doesn't reset it
+    RateDecision decision = rate_limiter_.tryConsume(connection->remoteAddress(), Budget::Pixel, now_());
+    if (!decision.allowed) {
+        // tell the client, so it can undo the pixel it placed optimistically
+        connection->send("[PIXEL/REJECT:" + std::to_string(pixel->x) + ":" + std::to_string(pixel->y) + ":" +
+                         std::to_string(decision.retry_after_ms) + "]");
+        return;
+    }
+
+    recordPlacement(pixel->x, pixel->y, pixel->color, ownerOf(connection));
+    canvas_.setPixel(pixel->x, pixel->y, pixel->color);
+    connection->send("[PIXEL/ACK:" + std::to_string(pixel->x) + ":" + std::to_string(pixel->y) + ":" +
+                     std::to_string(canvas_.version()) + "]");
+
+    if (log_pixels) {
+        std::cout << getClientName(connection) << ": Set pixel (" << pixel->x << "," << pixel->y << ") to "
+                  << (pixel->color ? "black" : "white") << std::endl;
+    }
+
+    // send the updated pixel to all connected clients
+    broadcast(command.message);
+}
+
+void ServerCore::handlePixels(Connection* connection, const ParsedCommand& command) {
+    auto batch = parsePixelBatch(command.payload);
+    if (!batch) {
+        std::cout << "Ignoring pixel batch, " << describePixelParseError(batch.error()) << ": "
+                  << command.message << std::endl;
+        return;
+    }
+    uint32_t pixels = batch->pixelCount();
+    if (pixels > STROKE_BURST) {
+        std::cout << "Ignoring pixel batch of " << pixels << " pixels, at most " << STROKE_BURST
+                  << " are allowed" << std::endl;
+        return;
+    }
+
+    // a batch counts as one placement for the cooldown and pays per pixel from the stroke budget
+    const Charge charges[] = {{Budget::Pixel, 1}, {Budget::Stroke, float(pixels)}};
+    RateDecision decision = rate_limiter_.tryConsume(connection->remoteAddress(), charges, now_());
+    if (!decision.allowed) {
+        connection->send("[PIXELS/REJECT:" + std::to_string(decision.retry_after_ms) + "]");
+        return;
+    }
+
+    PixelOwner owner = ownerOf(connection);
+    switch (batch->shape) {
+    case BatchShape::Run:
+    case BatchShape::Rect:
+        for (int y = batch->y; y < batch->y + batch->height; ++y) {
+            for (int x = batch->x; x < batch->x + batch->width; ++x) {
+                recordPlacement(x, y, batch->color, owner);
+            }
+        }
+        canvas_.fillRect(batch->x, batch->y, batch->width, batch->height, batch->color);
+        break;
+    case BatchShape::List:
+        for (uint8_t i = 0; i < batch->count; ++i) {
+            recordPlacement(batch->points[i].x, batch->points[i].y, batch->color, owner);
+        }
+        canvas_.setPixels(batch->points.data(), batch->count, batch->color);
+        break;
+    }
+    connection->send("[PIXELS/ACK:" + std::to_string(canvas_.version()) + "]");
+
+    if (log_pixels) {
+        std::cout << getClientName(connection) << ": Set " << pixels << " pixels to "
+                  << (batch->color ? "black" : "white") << std::endl;
+    }
+
+    // one frame for the whole batch
+    broadcast(command.message);
+}
+
+void ServerCore::onClose(Connection* connection) {
+    // get the time to print when the client disconnected
+    auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::cout << std::ctime(&time) << " Client disconnected" << std::endl;
+    clients_.erase(std::remove(clients_.begin(), clients_.end(), connection), clients_.end());
+
+    if (connection->session.admitted) {
+        admission_.release(std::string(connection->remoteAddress()));
+        connection->session.admitted = false;
+    }
+}
+
+void ServerCore::tick() {
+    auto now = now_();
+    uint32_t loop_lag = 0;
+    if (last_tick_ != Clock::time_point{}) {
+        auto late = now - last_tick_ - std::chrono::milliseconds(LOAD_SAMPLE_INTERVAL);
+        loop_lag = uint32_t(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(late).count()));
+    }
+    last_tick_ = now;
+
+    size_t queued_bytes = 0;
+    for (auto client : clients_) {
+        queued_bytes += client->bufferedAmount();
+    }
+
+    if (cooldown_.update(queued_bytes, loop_lag)) {
+        uint32_t timeout = cooldown_.timeout();
+        std::cout << "Pixel timeout is now " << timeout << " ms (queued " << queued_bytes << " bytes, loop lag "
+                  << loop_lag << " ms)" << std::endl;
+        rate_limiter_.configure(Budget::Pixel, PIXEL_BURST, timeout);
+        broadcast("[TIMEOUT:" + std::to_string(timeout) + "]");
+    }
+
+    for (auto client : clients_) {
+        if (client->session.sync.active()) {
+            continueSync(client);
+        }
+    }
+}
+
+void ServerCore::broadcast(std::string_view message, bool binary) {
+    for (auto client : clients_) {
+        client->send(message, binary);
+    }
+}
+
+namespace {
+
+// Changed bytes closer than this are sent in one chunk, a new chunk header costs about as much
+const size_t CHUNK_MERGE_GAP = 12;
+
+// The bytes [start, end) in upper case hex at the end of message
+void appendHex(std::string& message, const uint8_t* bytes, size_t start, size_t end) {
+    static const char HEX[] = "0123456789ABCDEF";
+    size_t header_length = message.size();
+    message.resize(header_length + (end - start) * 2);
+    char* out = message.data() + header_length;
+    for (size_t i = start; i < end; ++i) {
+        *out++ = HEX[bytes[i] >> 4];
+        *out++ = HEX[bytes[i] & 0x0F];
+    }
+}
+
+// "[MAP/CHUNK:id:start]" followed by the bytes [start, end) in hex
+void appendChunk(std::string& message, size_t chunk_id, size_t start, const uint8_t* bytes, size_t end) {
+    message = "[MAP/CHUNK:" + std::to_string(chunk_id) + ":" + std::to_string(start) + "]";
+    appendHex(message, bytes, start, end);
+}
+
+// Budget::Repair costs are in tiles, a [MAP/HASH] frame is about a fifth of a [MAP/TILE] one
+const float TILE_BYTES = CanvasHashTree::TILE_SIZE * CanvasHashTree::TILE_SIZE / 8.0f;
+const float HASH_COST = 0.25f;
+
+// Bytes that fit in one chunk starting at start
+size_t chunkCapacity(size_t chunk_id, size_t start) {
+    size_t header_length = 13 + std::to_string(chunk_id).size() + std::to_string(start).size();
+    return (MAX_PAYLOAD_SIZE - header_length) / 2;
+}
+
+} // namespace
+
+CanvasPyramid& ServerCore::pyramid() {
+    pyramid_.update(canvas_);
+    return pyramid_;
+}
+
+void ServerCore::handleMapOverview(Connection* connection, const ParsedCommand& command) {
+    // "[MAP/OVERVIEW:level]", one frame with the whole canvas downsampled by 2^level
+    int level = 0;
+    auto [end, error] = std::from_chars(command.argument.data(), command.argument.data() + command.argument.size(), level);
+    if (error != std::errc() || end != command.argument.data() + command.argument.size() ||
+        level < MIN_OVERVIEW_LEVEL || level >= CanvasPyramid::LEVELS) {
+        std::cout << "Invalid overview level received: " << command.message << std::endl;
+        return;
+    }
+    // charged before the pyramid is brought up to date, so a refused client costs no update
+    if (!charge(connection, Budget::Repair, float(pyramid_.overviewSize(level)) / TILE_BYTES)) {
+        return;
+    }
+    CanvasPyramid& levels = pyramid();
+    const std::vector<uint8_t>& bits = levels.overview(level);
+
+    // "[MAP/OVERVIEW:level:width:height]" followed by the cells, rows back to back, LSB first
+    std::string message = "[MAP/OVERVIEW:" + std::to_string(level) + ":" + std::to_string(levels.width(level)) + ":" +
+        std::to_string(levels.height(level)) + "]";
+    appendHex(message, bits.data(), 0, bits.size());
+    connection->send(message);
+}
+
+CanvasHashTree& ServerCore::hashTree() {
+    hash_tree_.update(canvas_);
+    return hash_tree_;
+}
+
+void ServerCore::sendHash(Connection* connection, std::string_view path, const CanvasHashTree::Node& node) {
+    // the node's hash and, above the tiles, the hashes of its four children
+    CanvasHashTree& tree = hashTree();
+    char hex[10];
+    std::string message = "[MAP/HASH:" + std::string(path) + "]";
+    std::snprintf(hex, sizeof(hex), "%08X", tree.hash(node));
+    message += hex;
+    if (node.depth < CanvasHashTree::DEPTH) {
+        for (int quadrant = 0; quadrant < 4; ++quadrant) {
+            CanvasHashTree::Node child{node.depth + 1, node.x * 2 + (quadrant & 1), node.y * 2 + (quadrant >> 1)};
+            std::snprintf(hex, sizeof(hex), ":%08X", tree.hash(child));
+            message += hex;
+        }
+    }
+    connection->send(message);
+}
+
+void ServerCore::handleMapHash(Connection* connection, const ParsedCommand& command) {
+    // "[MAP/HASH:path]"
+    std::optional<CanvasHashTree::Node> node = CanvasHashTree::parsePath(command.argument);
+    if (!node) {
+        std::cout << "Invalid hash path received: " << command.message << std::endl;
+        return;
+    }
+    if (!charge(connection, Budget::Repair, HASH_COST)) {
+        return;
+    }
+    sendHash(connection, command.argument, *node);
+}
+
+void ServerCore::handleMapResume(Connection* connection, const ParsedCommand& command) {
+    // "[MAP/RESUME:root]", sent before [NAME] by a client that restored its canvas from storage with
+    // the root hash it was saved with. A match is confirmed by "[MAP/END]", otherwise the client gets
+    // the root's children and walks down to the tiles that changed while it was away.
+    uint32_t root = 0;
+    auto [end, error] =
+        std::from_chars(command.argument.data(), command.argument.data() + command.argument.size(), root, 16);
+    if (error != std::errc() || end != command.argument.data() + command.argument.size()) {
+        std::cout << "Invalid resume hash received: " << command.message << std::endl;
+        return;
+    }
+    connection->session.resumed = true;
+    if (root == hashTree().root()) {
+        std::cout << "Client resumed an up to date canvas" << std::endl;
+        connection->send("[MAP/END]");
+        return;
+    }
+    // still resumed when refused, the client walks the tree after [MAP/RETRY]
+    if (!charge(connection, Budget::Repair, HASH_COST)) {
+        return;
+    }
+    sendHash(connection, "", {0, 0, 0});
+}
+
+void ServerCore::handleMapTile(Connection* connection, const ParsedCommand& command) {
+    // "[MAP/TILE:path]" for a tile path, answered with "[MAP/TILE:path:x:y:width:height]" and the
+    // tile's rows in hex, packed the way they are hashed
+    std::optional<CanvasHashTree::Node> node = CanvasHashTree::parsePath(command.argument);
+    if (!node || node->depth != CanvasHashTree::DEPTH) {
+        std::cout << "Invalid tile path received: " << command.message << std::endl;
+        return;
+    }
+    if (!charge(connection, Budget::Repair)) {
+        return;
+    }
+    CanvasHashTree::TileRect rect = CanvasHashTree::tileRect(node->x, node->y);
+    std::vector<uint8_t> bytes = hashTree().tileBytes(node->x, node->y);
+    std::string message = "[MAP/TILE:" + std::string(command.argument) + ":" + std::to_string(rect.x) + ":" +
+        std::to_string(rect.y) + ":" + std::to_string(rect.width) + ":" + std::to_string(rect.height) + "]";
+    appendHex(message, bytes.data(), 0, bytes.size());
+    connection->send(message);
+}
+
+void ServerCore::sendCanvasInChunks(Connection* connection) {
+    std::cout << "Sending canvas 🗺️ to client " << getClientName(connection) << "..." << std::endl;
+    connection->send("[MAP/SEND]");
+
+    const uint8_t* painted_bytes = canvas_.bytes();
+    size_t total_size = canvas_.size();
+
+    size_t start = 0;
+    size_t chunk_id = 0;
+    std::string chunk_message;
+
+    while (start < total_size) {
+        size_t end = std::min(start + chunkCapacity(chunk_id, start), total_size);
+        appendChunk(chunk_message, chunk_id, start, painted_bytes, end);
+        connection->send(chunk_message);
+
+        start = end;
+        chunk_id++;
+    }
+
+    connection->send("[MAP/END]");
+}
+
+void ServerCore::startSync(Connection* connection) {
+    Session& session = connection->session;
+    if (session.link_rate == 0) {
+        sendCanvasInChunks(connection);
+        return;
+    }
+    std::cout << "Sending canvas 🗺️ to client " << getClientName(connection) << " at " << session.link_rate
+              << " bytes/s from row " << session.view_y << "..." << std::endl;
+    // the client clears its canvas, the white runs are left out
+    connection->send("[MAP/CLEAR]");
+    session.sync.start(session.view_y, SYNC_VIEW_ROWS);
+    continueSync(connection);
+}
+
+void ServerCore::continueSync(Connection* connection) {
+    // what the link carries until the next tick, less what is still waiting in the socket.
+    // Pixel broadcasts go out right away and only wait behind one tick of sync.
+    Session& session = connection->session;
+    size_t budget = size_t(session.link_rate) * LOAD_SAMPLE_INTERVAL / 1000;
+    size_t buffered = connection->bufferedAmount();
+    budget = budget > buffered ? budget - buffered : 0;
+
+    const uint8_t* painted_bytes = canvas_.bytes();
+    std::string chunk_message;
+    size_t sent = 0;
+    while (sent < budget) {
+        // sized for the longest start, so the run fits whichever start it gets
+        bool in_view = session.sync.inView();
+        std::optional<SyncPlan::Run> run =
+            session.sync.next(painted_bytes, chunkCapacity(session.sync.chunks, canvas_.size()));
+        if (in_view && !session.sync.inView()) {
+            // the client can show its screen while the rest streams in
+            connection->send("[MAP/VIEW/END]");
+        }
+        if (!run) {
+            session.sync.clear();
+            connection->send("[MAP/END]");
+            return;
+        }
+        appendChunk(chunk_message, session.sync.chunks++, run->start, painted_bytes, run->end);
+        connection->send(chunk_message);
+        sent += chunk_message.size();
+    }
+}
+
+size_t ServerCore::applyRegion(RegionOp op, const CanvasRect& rect, const uint64_t* bitmap, const uint64_t* mask) {
+    if (!rect.valid() || (op == RegionOp::Stamp && !bitmap)) {
+        return 0;
+    }
+    std::vector<uint64_t> before(canvas_.words(), canvas_.words() + canvas_.wordCount());
+    switch (op) {
+    case RegionOp::Clear:
+        canvas_.fillRect(rect.x, rect.y, rect.width, rect.height, false);
+        break;
+    case RegionOp::Fill:
+        canvas_.fillRect(rect.x, rect.y, rect.width, rect.height, true);
+        break;
+    case RegionOp::Stamp:
+        canvas_.blit(rect, bitmap, mask);
+        break;
+    }
+
+    // admin writes are not kept in the history, rollbacks stop at them instead
+    PixelOwner owner{unixSeconds(), admin_user_, UNKNOWN_ID};
+    if (op == RegionOp::Stamp && mask) {
+        for (size_t i = 0; i < rect.area(); ++i) {
+            if ((mask[i / 64] >> (i % 64)) & 1) {
+                int x = rect.x + int(i % rect.width), y = rect.y + int(i / rect.width);
+                attribution_.record(x, y, owner);
+                history_.seal(uint32_t(y) * CANVAS_WIDTH + uint32_t(x));
+            }
+        }
+    } else {
+        attribution_.recordRect(rect, owner);
+        history_.sealRect(rect);
+    }
+    return broadcastChanges(before);
+}
+
+ServerCore::RollbackResult ServerCore::rollback(const RollbackFilter& filter) {
+    std::vector<Revert> reverts;
+    size_t placements = history_.rollback(filter, reverts);
+    if (reverts.empty()) {
+        return {placements, 0};
+    }
+
+    // one masked blit over the whole canvas, so the rollback is a single version step
+    std::vector<uint64_t> before(canvas_.words(), canvas_.words() + canvas_.wordCount());
+    std::vector<uint64_t> values(canvas_.wordCount(), 0), mask(canvas_.wordCount(), 0);
+    for (const Revert& revert : reverts) {
+        mask[revert.pixel / 64] |= uint64_t(1) << (revert.pixel % 64);
+        values[revert.pixel / 64] |= uint64_t(revert.color) << (revert.pixel % 64);
+        attribution_.record(int(revert.pixel % CANVAS_WIDTH), int(revert.pixel / CANVAS_WIDTH), revert.owner);
+    }
+    canvas_.blit({0, 0, CANVAS_WIDTH, CANVAS_HEIGHT}, values.data(), mask.data());
+    return {placements, broadcastChanges(before)};
+}
+
+size_t ServerCore::broadcastChanges(const std::vector<uint64_t>& before) {
+    std::vector<uint64_t> diff(canvas_.wordCount());
+    size_t changed = kernels::xorDiff(before.data(), canvas_.words(), diff.data(), diff.size());
+    if (changed == 0) {
+        return 0;
+    }
+
+    const uint8_t* diff_bytes = reinterpret_cast<const uint8_t*>(diff.data());
+    const uint8_t* painted_bytes = canvas_.bytes();
+    size_t total_size = canvas_.size();
+    size_t chunk_id = 0;
+    std::string chunk_message;
+
+    auto sendRun = [&](size_t start, size_t end) {
+        while (start < end) {
+            size_t stop = std::min(start + chunkCapacity(chunk_id, start), end);
+            appendChunk(chunk_message, chunk_id, start, painted_bytes, stop);
+            broadcast(chunk_message);
+            start = stop;
+            chunk_id++;
+        }
+    };
+
+    // walk the changed bytes, skipping unchanged words, and merge runs with small gaps
+    size_t run_start = 0, run_end = 0;
+    bool in_run = false;
+    for (size_t word = 0; word < diff.size(); ++word) {
+        if (diff[word] == 0) {
+            continue;
+        }
+        for (size_t i = word * 8; i < std::min(word * 8 + 8, total_size); ++i) {
+            if (diff_bytes[i] == 0) {
+                continue;
+            }
+            if (in_run && i - run_end <= CHUNK_MERGE_GAP) {
+                run_end = i + 1;
+                continue;
+            }
+            if (in_run) {
+                sendRun(run_start, run_end);
+            }
+            run_start = i;
+            run_end = i + 1;
+            in_run = true;
+        }
+    }
+    if (in_run) {
+        sendRun(run_start, run_end);
+    }
+    return changed;
+}
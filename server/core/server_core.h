@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "adaptive_cooldown.h"
+#include "admission.h"
+#include "attribution.h"
+#include "canvas.h"
+#include "canvas_hash_tree.h"
+#include "canvas_pyramid.h"
+#include "commands.h"
+#include "connection.h"
+#include "placement_history.h"
+#include "rate_limiter.h"
+
+enum class RegionOp : uint8_t {
+    Clear,
+    Fill,
+    Stamp, // blit a packed bitmap, optionally masked
+};
+
+// Transport independent server logic: the canvas, command handling and broadcasting.
+// Transports call onOpen/onMessage/onClose, the core answers through Connection.
+class ServerCore {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimeSource = Clock::time_point (*)();
+
+    explicit ServerCore(Canvas& canvas);
+
+    // Transports ask this before the handshake so refused clients stay cheap
+    Admission checkAdmission(const std::string& address);
+
+    // Returns false when the connection was refused (and closed)
+    bool onOpen(Connection* connection);
+    void onMessage(Connection* connection, std::string_view message);
+    void onClose(Connection* connection);
+
+    // Call every LOAD_SAMPLE_INTERVAL, samples the load, adapts the pixel cooldown and paces syncs
+    void tick();
+
+    void broadcast(std::string_view message, bool binary = false);
+    void sendCanvasInChunks(Connection* connection);
+
+    // Apply a bulk change in one step and send clients only the bytes that changed.
+    // Returns the number of changed pixels.
+    size_t applyRegion(RegionOp op, const CanvasRect& rect, const uint64_t* bitmap = nullptr,
+                       const uint64_t* mask = nullptr);
+    // Broadcast what differs between before and the canvas as a minimal set of [MAP/CHUNK] frames
+    size_t broadcastChanges(const std::vector<uint64_t>& before);
+
+    struct RollbackResult {
+        size_t placements; // reverted placements
+        size_t changed;    // pixels that changed color
+    };
+    // Revert the client placements matching filter and broadcast the changed bytes
+    RollbackResult rollback(const RollbackFilter& filter);
+
+    Canvas& canvas() { return canvas_; }
+    // Brought up to date with the canvas before it is returned
+    CanvasPyramid& pyramid();
+    CanvasHashTree& hashTree();
+    const AttributionPlane& attribution() const { return attribution_; }
+    const Interner& users() const { return users_; }
+    const Interner& addresses() const { return addresses_; }
+    size_t clientCount() const { return clients_.size(); }
+    uint32_t pixelTimeout() const { return cooldown_.timeout(); }
+
+    // Replace the clock, lets simulations run faster than real time
+    void setTimeSource(TimeSource time_source) { now_ = time_source; }
+
+    // Log every placed pixel to stdout
+    bool log_pixels = true;
+
+private:
+    using CommandHandler = void (ServerCore::*)(Connection* connection, const ParsedCommand& command);
+
+    void handleUnknown(Connection* connection, const ParsedCommand& command);
+    void handleStop(Connection* connection, const ParsedCommand& command);
+    void handleMapSync(Connection* connection, const ParsedCommand& command);
+    void handleName(Connection* connection, const ParsedCommand& command);
+    void handlePixel(Connection* connection, const ParsedCommand& command);
+    void handlePixels(Connection* connection, const ParsedCommand& command);
+    void handleMapOverview(Connection* connection, const ParsedCommand& command);
+    void handleMapHash(Connection* connection, const ParsedCommand& command);
+    void handleMapTile(Connection* connection, const ParsedCommand& command);
+    void handleMapResume(Connection* connection, const ParsedCommand& command);
+    void sendHash(Connection* connection, std::string_view path, const CanvasHashTree::Node& node);
+    // Take cost from the client's budget, false after telling it when to retry
+    bool charge(Connection* connection, Budget budget, float cost = 1);
+    // The whole canvas at once, or paced to the link the client advertised
+    void startSync(Connection* connection);
+    // Send the next frames of a paced sync, up to what the client's link carries in a tick
+    void continueSync(Connection* connection);
+
+    static const CommandHandler COMMAND_HANDLERS[];
+
+    // The attribution entry for a placement by connection right now
+    PixelOwner ownerOf(const Connection* connection) const;
+    // Remember who placed a pixel, call before the canvas changes
+    void recordPlacement(int x, int y, bool color, const PixelOwner& owner);
+
+    Canvas& canvas_;
+    std::vector<Connection*> clients_;
+    AdmissionControl admission_;
+    RateLimiter rate_limiter_;
+    AdaptiveCooldown cooldown_{PIXEL_PLACE_TIMEOUT, PIXEL_PLACE_TIMEOUT_MAX};
+    Interner users_;
+    Interner addresses_;
+    // has a space, which client names never do, so nobody can pose as the admin
+    InternId admin_user_ = users_.reserve("admin api");
+    AttributionPlane attribution_;
+    PlacementHistory history_{PLACEMENT_HISTORY};
+    CanvasPyramid pyramid_;
+    CanvasHashTree hash_tree_;
+    Clock::time_point last_tick_{};
+    TimeSource now_ = &Clock::now;
+};
+
+// function to get the name of the client if not unknown
+std::string getClientName(const Connection* connection);
@@ -0,0 +1,84 @@
+#include "spectator_feed.h"
+
+#include <algorithm>
+
+#include "canvas_kernels.h"
+
+namespace {
+
+// A run header costs 6 bytes, unchanged gaps up to that size are cheaper to send along
+const size_t RUN_MERGE_GAP = 6;
+const size_t MAX_RUN_LENGTH = UINT16_MAX;
+
+void appendLittleEndian(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out += char(value >> (8 * i));
+    }
+}
+
+} // namespace
+
+SpectatorFeed::SpectatorFeed() : words_((PAINTED_BYTES_SIZE + 7) / 8, 0), diff_(words_.size()) {}
+
+std::shared_ptr<const std::string> SpectatorFeed::snapshot() {
+    if (snapshot_version_ != version_) {
+        auto frame = std::make_shared<std::string>();
+        frame->reserve(9 + PAINTED_BYTES_SIZE);
+        *frame += 'S';
+        appendLittleEndian(*frame, version_, 8);
+        frame->append(reinterpret_cast<const char*>(words_.data()), PAINTED_BYTES_SIZE);
+        snapshot_ = std::move(frame);
+        snapshot_version_ = version_;
+    }
+    return snapshot_;
+}
+
+bool SpectatorFeed::collect(const Canvas& canvas, std::string& frame) {
+    if (canvas.version() == version_) {
+        return false;
+    }
+    version_ = canvas.version();
+    if (kernels::xorDiff(words_.data(), canvas.words(), diff_.data(), diff_.size()) == 0) {
+        return false;
+    }
+    std::copy(canvas.words(), canvas.words() + canvas.wordCount(), words_.begin());
+
+    frame.clear();
+    frame += 'U';
+    appendLittleEndian(frame, version_, 8);
+
+    const uint8_t* changed = reinterpret_cast<const uint8_t*>(diff_.data());
+    const uint8_t* bytes = canvas.bytes();
+    auto appendRun = [&](size_t start, size_t end) {
+        appendLittleEndian(frame, start, 4);
+        appendLittleEndian(frame, end - start, 2);
+        frame.append(reinterpret_cast<const char*>(bytes + start), end - start);
+    };
+
+    size_t run_start = 0, run_end = 0;
+    bool in_run = false;
+    for (size_t word = 0; word < diff_.size(); ++word) {
+        if (diff_[word] == 0) {
+            continue;
+        }
+        for (size_t i = word * 8; i < std::min(word * 8 + 8, canvas.size()); ++i) {
+            if (changed[i] == 0) {
+                continue;
+            }
+            if (in_run && i - run_end <= RUN_MERGE_GAP && i + 1 - run_start <= MAX_RUN_LENGTH) {
+                run_end = i + 1;
+                continue;
+            }
+            if (in_run) {
+                appendRun(run_start, run_end);
+            }
+            run_start = i;
+            run_end = i + 1;
+            in_run = true;
+        }
+    }
+    if (in_run) {
+        appendRun(run_start, run_end);
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "canvas.h"
+
+// Binary frames for read-only spectators, shared by all of them through pub/sub so a viewer
+// costs no per-connection state in the core. Integers are little endian.
+//
+//   'S' u64 version, then the canvas bytes                       sent once on connect
+//   'U' u64 version, then runs of (u32 offset, u16 length, bytes)  batched changes
+//
+// Runs carry the current bytes rather than a diff, so an update applies to any snapshot taken
+// after the previous update, and a viewer never has to wait for a consistent point. Snapshots are
+// taken of the canvas as of the last collect, so collect and publish first to hand out a fresh one.
+class SpectatorFeed {
+public:
+    SpectatorFeed();
+
+    // The snapshot frame of the canvas at the last collect, built once per collected version
+    std::shared_ptr<const std::string> snapshot();
+    // The update frame with everything that changed since the last call, false when nothing did
+    bool collect(const Canvas& canvas, std::string& frame);
+
+private:
+    std::vector<uint64_t> words_; // the canvas at the last collect
+    std::vector<uint64_t> diff_;
+    uint64_t version_ = 0;
+
+    std::shared_ptr<const std::string> snapshot_;
+    uint64_t snapshot_version_ = UINT64_MAX; // the version_ snapshot_ was built at
+};
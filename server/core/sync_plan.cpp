@@ -0,0 +1,71 @@
+#include "sync_plan.h"
+
+#include <algorithm>
+
+#include "config.h"
+
+namespace {
+
+// White bytes closer than this stay in one run, a new chunk header costs about as much
+const size_t ZERO_GAP = 12;
+
+// First byte holding a pixel of row y, rows are not byte aligned so a boundary byte goes to the lower band
+size_t rowStart(int y) {
+    return size_t(y) * CANVAS_WIDTH / 8;
+}
+
+} // namespace
+
+void SyncPlan::start(int view_y, int view_height) {
+    spans_.clear();
+    next_ = 0;
+    chunks = 0;
+
+    int top = std::clamp(view_y, 0, CANVAS_HEIGHT - 1);
+    int bottom = std::clamp(view_y + view_height, top + 1, CANVAS_HEIGHT);
+    auto add = [&](int from, int to) {
+        size_t end = to == CANVAS_HEIGHT ? PAINTED_BYTES_SIZE : rowStart(to);
+        spans_.push_back({rowStart(from), end});
+    };
+    add(top, bottom);
+    while (top > 0 || bottom < CANVAS_HEIGHT) {
+        if (bottom < CANVAS_HEIGHT) {
+            int to = std::min(bottom + SYNC_BAND_ROWS, CANVAS_HEIGHT);
+            add(bottom, to);
+            bottom = to;
+        }
+        if (top > 0) {
+            int from = std::max(top - SYNC_BAND_ROWS, 0);
+            add(from, top);
+            top = from;
+        }
+    }
+}
+
+std::optional<SyncPlan::Run> SyncPlan::next(const uint8_t* bytes, size_t max_bytes) {
+    while (next_ < spans_.size()) {
+        Run& span = spans_[next_];
+        while (span.start < span.end && bytes[span.start] == 0) {
+            span.start++;
+        }
+        if (span.start == span.end) {
+            next_++;
+            continue;
+        }
+
+        // extend over white gaps shorter than ZERO_GAP, end on the last non-white byte
+        size_t limit = std::min(span.end, span.start + max_bytes);
+        size_t end = span.start + 1;
+        for (size_t i = end; i < limit; ++i) {
+            if (bytes[i] != 0) {
+                end = i + 1;
+            } else if (i - end >= ZERO_GAP) {
+                break;
+            }
+        }
+        Run run{span.start, end};
+        span.start = end;
+        return run;
+    }
+    return std::nullopt;
+}
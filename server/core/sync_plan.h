@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// The canvas bytes a paced sync still has to send, the rows around the client's view first.
+// The client clears its canvas when the sync starts, so runs of white bytes are skipped.
+class SyncPlan {
+public:
+    struct Run {
+        size_t start;
+        size_t end;
+    };
+
+    // Plan a sync of the canvas bytes for a client looking at rows [view_y, view_y + view_height),
+    // then bands of SYNC_BAND_ROWS rows alternating below and above, further and further away
+    void start(int view_y, int view_height);
+    void clear() { spans_.clear(); next_ = 0; }
+    bool active() const { return next_ < spans_.size(); }
+    // still sending the rows of the client's view
+    bool inView() const { return next_ == 0 && !spans_.empty(); }
+
+    // Next run of at most max_bytes non-white bytes, nullopt when the sync is done
+    std::optional<Run> next(const uint8_t* bytes, size_t max_bytes);
+
+    // frames sent so far, numbers the [MAP/CHUNK] frames
+    size_t chunks = 0;
+
+private:
+    std::vector<Run> spans_;
+    size_t next_ = 0;
+};
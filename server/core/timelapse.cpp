@@ -0,0 +1,368 @@
+#include "timelapse.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <zlib.h>
+
+#include "canvas_kernels.h"
+#include "config.h"
+
+namespace {
+
+const char TIMELAPSE_MAGIC[4] = {'P', 'T', 'L', 'X'};
+const uint32_t TIMELAPSE_VERSION = 1;
+
+// A segment that grew past this many bytes is closed early, a keyframe is cheaper from here on
+const size_t MAX_SEGMENT_SIZE = 4 * PAINTED_BYTES_SIZE;
+
+void appendVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+bool readVarint(const std::vector<uint8_t>& in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        uint8_t byte = in[pos++];
+        value |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Walks the change groups of a segment in time order
+struct SegmentCursor {
+    const std::vector<uint8_t>* segment;
+    uint32_t keyframe_time;
+    size_t pos = 0;
+
+    // Applies the groups up to and including time t to bytes, false on a corrupt segment
+    bool applyUntil(uint32_t t, uint8_t* bytes) {
+        while (pos < segment->size()) {
+            size_t group = pos;
+            uint64_t offset, count;
+            if (!readVarint(*segment, pos, offset) || !readVarint(*segment, pos, count)) {
+                return false;
+            }
+            if (keyframe_time + offset > t) {
+                pos = group;
+                return true;
+            }
+            uint64_t pixel = 0;
+            for (uint64_t i = 0; i < count; ++i) {
+                uint64_t value;
+                if (!readVarint(*segment, pos, value)) {
+                    return false;
+                }
+                pixel += value >> 1;
+                if (pixel >= uint64_t(CANVAS_WIDTH) * CANVAS_HEIGHT) {
+                    return false;
+                }
+                uint8_t bit = uint8_t(1 << (pixel % 8));
+                bytes[pixel / 8] = (value & 1) ? (bytes[pixel / 8] | bit) : (bytes[pixel / 8] & ~bit);
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+TimelapseWriter::TimelapseWriter(std::string directory) : directory_(directory), reader_(std::move(directory)) {}
+
+TimelapseWriter::~TimelapseWriter() {
+    close();
+}
+
+bool TimelapseWriter::open() {
+    if (opened_ || failed_) {
+        return opened_;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+
+    std::string index_path = directory_ + "/timelapse.idx";
+    std::string data_path = directory_ + "/timelapse.dat";
+
+    TimelapseHeader expected{};
+    std::memcpy(expected.magic, TIMELAPSE_MAGIC, sizeof(expected.magic));
+    expected.version = TIMELAPSE_VERSION;
+    expected.width = CANVAS_WIDTH;
+    expected.height = CANVAS_HEIGHT;
+
+    if (std::filesystem::exists(index_path)) {
+        // keep appending to an existing timelapse, but only one of this canvas
+        TimelapseHeader header{};
+        std::ifstream index(index_path, std::ios::binary);
+        if (!index.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(&header, &expected, sizeof(header)) != 0) {
+            std::cerr << "Timelapse index " << index_path << " is from another canvas, not recording" << std::endl;
+            failed_ = true;
+            return false;
+        }
+    } else {
+        std::ofstream index(index_path, std::ios::binary);
+        index.write(reinterpret_cast<const char*>(&expected), sizeof(expected));
+        if (!index) {
+            std::cerr << "Failed to create timelapse index " << index_path << std::endl;
+            failed_ = true;
+            return false;
+        }
+    }
+    // records the index doesn't know about (a crash between the two writes) are just skipped
+    data_size_ = std::filesystem::exists(data_path) ? std::filesystem::file_size(data_path) : 0;
+
+    std::cout << "Recording timelapse 🎞️ to " << directory_ << std::endl;
+    opened_ = true;
+    return true;
+}
+
+bool TimelapseWriter::appendRecord(TimelapseRecord kind, uint32_t start_time, uint32_t end_time,
+                                   const std::vector<uint8_t>& raw) {
+    uLongf stored_size = compressBound(raw.size());
+    std::vector<uint8_t> stored(stored_size);
+    if (compress2(stored.data(), &stored_size, raw.data(), raw.size(), Z_BEST_COMPRESSION) != Z_OK) {
+        std::cerr << "Failed to compress timelapse record" << std::endl;
+        return false;
+    }
+
+    std::ofstream data(directory_ + "/timelapse.dat", std::ios::binary | std::ios::app);
+    data.write(reinterpret_cast<const char*>(stored.data()), stored_size);
+    if (!data.flush()) {
+        std::cerr << "Failed to write timelapse data" << std::endl;
+        return false;
+    }
+
+    TimelapseIndexEntry entry{};
+    entry.start_time = start_time;
+    entry.end_time = end_time;
+    entry.offset = data_size_;
+    entry.stored_size = uint32_t(stored_size);
+    entry.raw_size = uint32_t(raw.size());
+    entry.kind = uint8_t(kind);
+    data_size_ += stored_size;
+
+    std::ofstream index(directory_ + "/timelapse.idx", std::ios::binary | std::ios::app);
+    index.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    if (!index.flush()) {
+        return false;
+    }
+    if (kind == TimelapseRecord::Keyframe) {
+        keyframe_entry_offset_ = uint64_t(index.tellp()) - sizeof(entry);
+    }
+    records_++;
+    return true;
+}
+
+void TimelapseWriter::extendRecord(uint32_t now) {
+    if (!segment_.empty()) {
+        end_time_ = now;
+        return;
+    }
+    // only the keyframe is on disk, rewrite its end time in place
+    std::fstream index(directory_ + "/timelapse.idx", std::ios::binary | std::ios::in | std::ios::out);
+    index.seekp(std::streamoff(keyframe_entry_offset_ + offsetof(TimelapseIndexEntry, end_time)));
+    index.write(reinterpret_cast<const char*>(&now), sizeof(now));
+    if (!index.flush()) {
+        std::cerr << "Failed to extend timelapse record" << std::endl;
+        return;
+    }
+    records_++; // the reader has to reload the index
+}
+
+void TimelapseWriter::startKeyframe(const Canvas& canvas, uint32_t now) {
+    keyframe_bytes_.assign(canvas.bytes(), canvas.bytes() + canvas.size());
+    if (!appendRecord(TimelapseRecord::Keyframe, now, now, keyframe_bytes_)) {
+        return;
+    }
+    last_words_.assign(canvas.words(), canvas.words() + canvas.wordCount());
+    diff_.resize(canvas.wordCount());
+    last_version_ = canvas.version();
+    keyframe_time_ = now;
+    next_keyframe_time_ = now + TIMELAPSE_KEYFRAME_INTERVAL;
+    end_time_ = now;
+    segment_.clear();
+    in_segment_ = true;
+}
+
+void TimelapseWriter::capture(const Canvas& canvas, uint32_t now) {
+    if (!open()) {
+        return;
+    }
+    last_capture_ = now;
+    if (!in_segment_ || segment_.size() > MAX_SEGMENT_SIZE) {
+        close();
+        startKeyframe(canvas, now);
+        return;
+    }
+    if (canvas.version() == last_version_) {
+        // a keyframe of an idle canvas would repeat the last one
+        if (now >= next_keyframe_time_) {
+            next_keyframe_time_ = now + TIMELAPSE_KEYFRAME_INTERVAL;
+            extendRecord(now);
+        }
+        return;
+    }
+    if (now >= next_keyframe_time_) {
+        close();
+        startKeyframe(canvas, now);
+        return;
+    }
+    last_version_ = canvas.version();
+
+    size_t changed = kernels::xorDiff(last_words_.data(), canvas.words(), diff_.data(), diff_.size());
+    if (changed == 0) {
+        return;
+    }
+
+    appendVarint(segment_, now - keyframe_time_);
+    appendVarint(segment_, changed);
+    uint64_t previous = 0;
+    for (size_t word = 0; word < diff_.size(); ++word) {
+        for (uint64_t bits = diff_[word]; bits; bits &= bits - 1) {
+            uint64_t pixel = word * 64 + std::countr_zero(bits);
+            bool color = (canvas.words()[word] >> (pixel % 64)) & 1;
+            appendVarint(segment_, ((pixel - previous) << 1) | color);
+            previous = pixel;
+        }
+    }
+    last_words_.assign(canvas.words(), canvas.words() + canvas.wordCount());
+    end_time_ = now;
+}
+
+void TimelapseWriter::close() {
+    if (in_segment_ && !segment_.empty()) {
+        appendRecord(TimelapseRecord::Segment, keyframe_time_, end_time_, segment_);
+    }
+    segment_.clear();
+    in_segment_ = false;
+}
+
+bool TimelapseWriter::canvasAt(uint32_t t, std::vector<uint8_t>& bytes) {
+    if (in_segment_ && t >= keyframe_time_) {
+        bytes = keyframe_bytes_;
+        SegmentCursor cursor{&segment_, keyframe_time_};
+        return cursor.applyUntil(t, bytes.data());
+    }
+    if (reader_records_ != records_) {
+        if (!reader_.open()) {
+            return false;
+        }
+        reader_records_ = records_;
+    }
+    return reader_.canvasAt(t, bytes);
+}
+
+TimelapseReader::TimelapseReader(std::string directory) : directory_(std::move(directory)) {}
+
+bool TimelapseReader::open() {
+    std::ifstream index(directory_ + "/timelapse.idx", std::ios::binary);
+    TimelapseHeader header{};
+    if (!index.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, TIMELAPSE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TIMELAPSE_VERSION || header.width != CANVAS_WIDTH || header.height != CANVAS_HEIGHT) {
+        return false;
+    }
+    index_.clear();
+    TimelapseIndexEntry entry;
+    while (index.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+        index_.push_back(entry);
+    }
+    // reopening picks up what the writer appended since
+    data_.close();
+    data_.clear();
+    data_.open(directory_ + "/timelapse.dat", std::ios::binary);
+    return bool(data_);
+}
+
+uint32_t TimelapseReader::firstTime() const {
+    return index_.empty() ? 0 : index_.front().start_time;
+}
+
+uint32_t TimelapseReader::lastTime() const {
+    return index_.empty() ? 0 : index_.back().end_time;
+}
+
+ptrdiff_t TimelapseReader::findKeyframe(uint32_t t) const {
+    // entries are in time order, find the first one after t and step back to a keyframe
+    auto it = std::upper_bound(index_.begin(), index_.end(), t,
+                               [](uint32_t time, const TimelapseIndexEntry& entry) { return time < entry.start_time; });
+    ptrdiff_t k = (it - index_.begin()) - 1;
+    while (k >= 0 && index_[k].kind != uint8_t(TimelapseRecord::Keyframe)) {
+        k--;
+    }
+    return k;
+}
+
+bool TimelapseReader::readRecord(const TimelapseIndexEntry& entry, std::vector<uint8_t>& raw) {
+    std::vector<uint8_t> stored(entry.stored_size);
+    data_.clear();
+    data_.seekg(std::streamoff(entry.offset));
+    if (!data_.read(reinterpret_cast<char*>(stored.data()), stored.size())) {
+        return false;
+    }
+    raw.resize(entry.raw_size);
+    uLongf raw_size = entry.raw_size;
+    return uncompress(raw.data(), &raw_size, stored.data(), stored.size()) == Z_OK && raw_size == entry.raw_size;
+}
+
+bool TimelapseReader::loadKeyframe(size_t k, std::vector<uint8_t>& bytes, std::vector<uint8_t>& segment) {
+    if (!readRecord(index_[k], bytes) || bytes.size() != PAINTED_BYTES_SIZE) {
+        return false;
+    }
+    segment.clear();
+    if (k + 1 < index_.size() && index_[k + 1].kind == uint8_t(TimelapseRecord::Segment)) {
+        return readRecord(index_[k + 1], segment);
+    }
+    return true;
+}
+
+bool TimelapseReader::canvasAt(uint32_t t, std::vector<uint8_t>& bytes) {
+    ptrdiff_t k = findKeyframe(t);
+    std::vector<uint8_t> segment;
+    if (k < 0 || !loadKeyframe(size_t(k), bytes, segment)) {
+        return false;
+    }
+    SegmentCursor cursor{&segment, index_[k].start_time};
+    return cursor.applyUntil(t, bytes.data());
+}
+
+bool TimelapseReader::forEachFrame(uint32_t from, uint32_t to, uint32_t step, const FrameCallback& frame) {
+    if (step == 0) {
+        return false;
+    }
+    std::vector<uint8_t> bytes, segment;
+    ptrdiff_t loaded = -1;
+    SegmentCursor cursor{&segment, 0};
+
+    for (uint64_t t = from; t <= to; t += step) {
+        ptrdiff_t k = findKeyframe(uint32_t(t));
+        if (k < 0) {
+            continue;
+        }
+        // only move to the next keyframe when the frame is past it, otherwise keep replaying
+        if (k != loaded) {
+            if (!loadKeyframe(size_t(k), bytes, segment)) {
+                return false;
+            }
+            loaded = k;
+            cursor = SegmentCursor{&segment, index_[k].start_time};
+        }
+        if (!cursor.applyUntil(uint32_t(t), bytes.data())) {
+            return false;
+        }
+        if (!frame(uint32_t(t), bytes.data())) {
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "canvas.h"
+
+// Append-only canvas history for timelapses. A full keyframe of the bitset is written every
+// TIMELAPSE_KEYFRAME_INTERVAL, followed by one segment with every pixel change until the next
+// keyframe, both zlib compressed. Any moment is one keyframe plus a prefix of its segment.
+// While the canvas doesn't change no keyframes are added, the last record's end time grows instead.
+//
+//   <dir>/timelapse.idx   TimelapseHeader, then one TimelapseIndexEntry per record
+//   <dir>/timelapse.dat   the compressed records back to back
+//
+// A segment is a list of change groups: varint seconds since its keyframe, varint count, then
+// count varints of (pixel index gap << 1 | color), the pixel indices ascending within a group.
+
+enum class TimelapseRecord : uint8_t {
+    Keyframe = 1,
+    Segment = 2,
+};
+
+struct TimelapseHeader {
+    char magic[4]; // "PTLX"
+    uint32_t version;
+    uint16_t width;
+    uint16_t height;
+    uint32_t reserved;
+};
+static_assert(sizeof(TimelapseHeader) == 16, "TimelapseHeader is stored as is");
+
+struct TimelapseIndexEntry {
+    uint32_t start_time; // unix seconds
+    uint32_t end_time;   // the last change, or the last idle capture, the record covers
+    uint64_t offset;     // in the data file
+    uint32_t stored_size;
+    uint32_t raw_size;
+    uint8_t kind; // TimelapseRecord
+    uint8_t reserved[7];
+};
+static_assert(sizeof(TimelapseIndexEntry) == 32, "TimelapseIndexEntry is stored as is");
+
+// Reads a timelapse written by TimelapseWriter, holding at most one keyframe and one segment
+class TimelapseReader {
+public:
+    // Called with the time and the canvas bytes, return false to stop
+    using FrameCallback = std::function<bool(uint32_t time, const uint8_t* bytes)>;
+
+    explicit TimelapseReader(std::string directory);
+
+    bool open();
+
+    // The canvas at time t into bytes (PAINTED_BYTES_SIZE), false when t is before the first keyframe
+    bool canvasAt(uint32_t t, std::vector<uint8_t>& bytes);
+    // A frame every step seconds from from to to, one keyframe and segment in memory at a time
+    bool forEachFrame(uint32_t from, uint32_t to, uint32_t step, const FrameCallback& frame);
+
+    const std::vector<TimelapseIndexEntry>& entries() const { return index_; }
+    // First keyframe and last recorded change, 0 when empty
+    uint32_t firstTime() const;
+    uint32_t lastTime() const;
+
+private:
+    // Index of the last keyframe at or before t, -1 when there is none
+    ptrdiff_t findKeyframe(uint32_t t) const;
+    bool readRecord(const TimelapseIndexEntry& entry, std::vector<uint8_t>& raw);
+    // Loads keyframe k into bytes and its segment (if any) into segment
+    bool loadKeyframe(size_t k, std::vector<uint8_t>& bytes, std::vector<uint8_t>& segment);
+
+    std::string directory_;
+    std::vector<TimelapseIndexEntry> index_;
+    std::ifstream data_;
+};
+
+class TimelapseWriter {
+public:
+    explicit TimelapseWriter(std::string directory);
+    ~TimelapseWriter();
+
+    // Call regularly (every tick), records what changed since the last call
+    void capture(const Canvas& canvas, uint32_t now);
+    // Write the open segment, the next capture starts with a keyframe
+    void close();
+
+    // The canvas at time t, from the open segment in memory or the records on disk
+    bool canvasAt(uint32_t t, std::vector<uint8_t>& bytes);
+    // Time of the last capture, the history up to before it is final
+    uint32_t lastCapture() const { return last_capture_; }
+
+private:
+    bool open();
+    void startKeyframe(const Canvas& canvas, uint32_t now);
+    bool appendRecord(TimelapseRecord kind, uint32_t start_time, uint32_t end_time, const std::vector<uint8_t>& raw);
+    // An idle interval passed, the open segment or the keyframe on disk covers it too
+    void extendRecord(uint32_t now);
+
+    std::string directory_;
+    bool opened_ = false;
+    bool failed_ = false;
+    uint64_t data_size_ = 0;
+
+    bool in_segment_ = false;
+    uint32_t keyframe_time_ = 0;
+    uint32_t next_keyframe_time_ = 0;
+    uint32_t end_time_ = 0; // of the open segment
+    uint64_t keyframe_entry_offset_ = 0; // in the index file
+    uint64_t last_version_ = 0;
+    std::vector<uint64_t> last_words_; // the canvas at the last capture
+    std::vector<uint64_t> diff_;
+    std::vector<uint8_t> segment_; // encoded changes since the keyframe
+    std::vector<uint8_t> keyframe_bytes_;
+    uint32_t last_capture_ = 0;
+
+    // Answers for the closed records, reopened when new ones were written
+    TimelapseReader reader_;
+    uint64_t records_ = 0;
+    uint64_t reader_records_ = UINT64_MAX;
+};
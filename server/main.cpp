@@ -1,130 +1,88 @@
 #include <App.h>
+#include <cstdlib>
 #include <iostream>
-#include <vector>
-#include <algorithm>
-#include <cstdint>
+#include <string>
 #include <thread>
-#include <fstream>   // for file operations
 #include <atomic>    // for safe thread stop flag
 #include <chrono>    // for sleep_for
 #include <filesystem>
+#include <memory>
 
-#define WEBSOCKET_PORT 80
-#define MAX_CLIENTS 75
-#define SAVE_INTERVAL (10 * 60) // 10 minutes
-#define PIXEL_PLACE_TIMEOUT   1000 // 1 second in milliseconds
+#include "core/canvas_history.h"
+#include "core/http_api.h"
+#include "core/server_core.h"
+#include "core/spectator_feed.h"
+#include "core/timelapse.h"
 
-// Canvas configuration
-const int CANVAS_WIDTH = 500;
-const int CANVAS_HEIGHT = 500;
-const size_t PAINTED_BYTES_SIZE = ((CANVAS_WIDTH * CANVAS_HEIGHT + 7) / 8); // 1 byte = 8 bits
-const int MAX_PAYLOAD_SIZE = 2048;
-const int CHUNK_SEND_DELAY_MS = 250; // Delay between sending chunks in milliseconds
-
-struct MyUserData {
-    std::string flipper_name;
-    // timeout for pixel updates
-    std::chrono::time_point<std::chrono::steady_clock> last_pixel_update;
-};
-
-uint8_t* painted_bytes = nullptr; // Global variable to hold the painted bytes (canvas)
-
-// string for the current map file name
-std::string current_map_file = "flipper_map.bin";
-
-std::atomic<bool> keep_saving(true); // Flag to control the save thread
+struct MyUserData;
 
 using WebSocketType = uWS::WebSocket<false, true, MyUserData>; // Server, with SSL support
 
-// Global vector to keep track of all connected clients
-std::vector<WebSocketType*> clients;
-
-// funxtion to get the name of the client if not unknown
-std::string getClientName(WebSocketType* ws) {
-    std::string client_name = ws->getUserData()->flipper_name;
-    if (client_name.empty()) {
-        client_name = "Unknown";
+// uWS adapter for the transport independent Connection
+class UwsConnection : public Connection {
+public:
+    void send(std::string_view message, bool binary = false) override {
+        ws->send(message, binary ? uWS::BINARY : uWS::TEXT);
     }
-    return client_name;
-}
-
-void sendCanvasInChunks(WebSocketType* ws) {    
-    std::cout << "Sending canvas 🗺️ to client " << getClientName(ws) << "..." << std::endl;
-    ws->send("[MAP/SEND]", uWS::TEXT);
+    void close() override { ws->close(); }
+    std::string_view remoteAddress() const override { return address; }
+    size_t bufferedAmount() const override { return ws->getBufferedAmount(); }
 
-    size_t total_size = PAINTED_BYTES_SIZE;
+    WebSocketType* ws = nullptr;
+    std::string address; // resolved once in the upgrade handler
+};
 
-    size_t start = 0;
-    size_t chunk_id = 0;
+struct MyUserData {
+    UwsConnection connection;
+};
 
-    while (start < total_size) {
-        size_t available_space = MAX_PAYLOAD_SIZE;
+// Spectators keep nothing, everything they get is published to SPECTATOR_TOPIC
+struct SpectatorData {};
 
-        // Create header with chunk id and start offset
-        std::string chunk_header = "[MAP/CHUNK:" + std::to_string(chunk_id) + ":" + std::to_string(start) + "]";
-        size_t header_length = chunk_header.size();
-        available_space -= header_length;
+const std::string_view SPECTATOR_TOPIC = "spectate";
 
-        size_t bytes_can_send = available_space / 2;
-        size_t end = std::min(start + bytes_can_send, total_size);
+// string for the current map file name
+std::string current_map_file = "flipper_map.bin";
 
-        std::string chunk_message = chunk_header;
+std::atomic<bool> keep_saving(true); // Flag to control the save thread
 
-        for (size_t i = start; i < end; ++i) {
-            char hex_byte[3];
-            snprintf(hex_byte, sizeof(hex_byte), "%02X", painted_bytes[i]);
-            chunk_message += hex_byte;
+Canvas canvas;
+ServerCore server(canvas);
+TimelapseWriter timelapse("maps/timelapse");
+CanvasHistory history(timelapse, HISTORY_CACHE_ENTRIES);
+SpectatorFeed spectator_feed;
+HttpApi http_api(server, std::getenv("PAINTERS_ADMIN_TOKEN") ? std::getenv("PAINTERS_ADMIN_TOKEN") : "", &history);
+
+// Behind a reverse proxy every socket comes from the proxy, so take the client
+// address from its headers instead. Only enable this when the server is not exposed directly.
+bool trust_proxy_headers = false;
+
+template <typename Response>
+std::string getRequestAddress(Response* res, uWS::HttpRequest* req) {
+    if (trust_proxy_headers) {
+        std::string_view real_ip = req->getHeader("x-real-ip");
+        if (!real_ip.empty()) {
+            return std::string(real_ip);
+        }
+        // first entry of "client, proxy1, proxy2"
+        std::string_view forwarded = req->getHeader("x-forwarded-for");
+        forwarded = forwarded.substr(0, forwarded.find(','));
+        if (!forwarded.empty()) {
+            return std::string(forwarded);
         }
-
-        ws->send(chunk_message, uWS::TEXT);
-
-        start = end;
-        chunk_id++;
-    }
-
-    ws->send("[MAP/END]", uWS::TEXT);
-}
-
-// Sets a pixel in the bit array at (x, y) to the specified color (1 = painted, 0 = not painted)
-void setPixel(int x, int y, bool color) {
-    if (x < 0 || x >= CANVAS_WIDTH || y < 0 || y >= CANVAS_HEIGHT) {
-        std::cerr << "Invalid pixel coordinates: (" << x << ", " << y << ")" << std::endl;
-        return;
-    }
-
-    size_t index = (y * CANVAS_WIDTH + x) / 8;
-    size_t bit = (y * CANVAS_WIDTH + x) % 8;
-
-    if (color) {
-        painted_bytes[index] |= (1 << bit); // Set the bit to 1
-    } else {
-        painted_bytes[index] &= ~(1 << bit); // Set the bit to 0
-    }
-}
-
-void saveCanvasToFile(const std::string& filename) {
-    std::ofstream out_file(filename, std::ios::binary);
-    if (!out_file) {
-        std::cerr << "Failed to open file for saving: " << filename << std::endl;
-        return;
-    }
-    out_file.write(reinterpret_cast<char*>(painted_bytes), PAINTED_BYTES_SIZE);
-    if (!out_file) {
-        std::cerr << "Failed to write canvas to file: " << filename << std::endl;
-    } else {
-        std::cout << "Canvas saved to file: " << filename << std::endl;
     }
+    return std::string(res->getRemoteAddressAsText());
 }
 
 int main() {
     std::cout << "Starting WebSocket server... 🚀" << std::endl;
 
-    painted_bytes = (uint8_t*)malloc(PAINTED_BYTES_SIZE);
-    if(!painted_bytes) {
-        std::cerr << "Failed to allocate memory for painted bytes (canvas)" << std::endl;
-        return -1;
+    const char* trust_proxy = std::getenv("PAINTERS_TRUST_PROXY");
+    trust_proxy_headers = trust_proxy && std::string_view(trust_proxy) == "1";
+
+    if (!http_api.adminEnabled()) {
+        std::cout << "Admin API disabled, set PAINTERS_ADMIN_TOKEN to enable it" << std::endl;
     }
-    memset(painted_bytes, 0, PAINTED_BYTES_SIZE);
 
     std::thread save_thread;
 
@@ -145,172 +103,134 @@ int main() {
             std::filesystem::create_directory(maps_dir);
         }
 
-        // if map file exists, load it in painted_bytes
+        // if map file exists, load it in the canvas
         if (std::filesystem::exists(maps_path)) {
             std::cout << "Loading saved map 🗺️ 💾: " << maps_path << std::endl;
-            std::ifstream in_file(maps_path, std::ios::binary);
-            if (in_file) {
-                in_file.read(reinterpret_cast<char*>(painted_bytes), PAINTED_BYTES_SIZE);
-                if (!in_file) {
-                    std::cerr << "Failed to read canvas from file: " << maps_path << std::endl;
-                } else {
-                    std::cout << "Canvas loaded from file: " << maps_path << std::endl;
-                }
-            } else {
-                std::cerr << "Failed to open file for loading: " << maps_path << std::endl;
-            }
+            canvas.loadFromFile(maps_path);
         }
 
         while (keep_saving) {
             std::this_thread::sleep_for(save_interval);
             // check if there are any clients connected if not, don't save
-            if (clients.empty()) {
+            if (server.clientCount() == 0) {
                 continue;
             }
-            saveCanvasToFile(maps_path);
+            canvas.saveToFile(maps_path);
         }
     });
 
-    uWS::App()
-        .ws<MyUserData>(
+    uWS::App app;
+    // Read-only viewers, registered first so "/*" doesn't take them. They are not counted
+    // against MAX_CLIENTS, and a viewer that can't keep up is dropped instead of buffered.
+    app.ws<SpectatorData>(
+            "/spectate",
+            {
+                .compression = uWS::SHARED_COMPRESSOR,
+                .maxPayloadLength = 64, // they have nothing to say
+                .idleTimeout = 120,
+                .maxBackpressure = 4 * PAINTED_BYTES_SIZE,
+                .closeOnBackpressureLimit = true,
+                .open = [&app](uWS::WebSocket<false, true, SpectatorData>* ws) {
+                    // bring the viewers up to date first, the snapshot is of the last collect
+                    static std::string frame;
+                    if (spectator_feed.collect(canvas, frame)) {
+                        app.publish(SPECTATOR_TOPIC, frame, uWS::BINARY, true);
+                    }
+                    ws->send(*spectator_feed.snapshot(), uWS::BINARY, true);
+                    ws->subscribe(SPECTATOR_TOPIC);
+                },
+                .message = [](uWS::WebSocket<false, true, SpectatorData>* /*ws*/, std::string_view /*message*/,
+                              uWS::OpCode /*opCode*/) {
+                    // inbound messages are ignored
+                },
+            });
+    app.ws<MyUserData>(
             "/*",
             {
                 .compression = uWS::SHARED_COMPRESSOR,
-                .maxPayloadLength = 64, // For incoming messages (5 bytes < 1024)
+                .maxPayloadLength = MAX_MESSAGE_LENGTH, // For incoming messages, [PIXELS] batches are the longest
                 .idleTimeout = 420, // 7 minutes idle timeout
-                .open = [](WebSocketType* ws) {
-                    // limit the number of connected clients
-                    if (clients.size() > MAX_CLIENTS) {
-                        std::cout << "Max clients reached" << std::endl;
-                        ws->close();
+                .upgrade = [](auto* res, auto* req, auto* context) {
+                    // admit or reject before the handshake, so a connect storm costs no WebSocket state
+                    std::string address = getRequestAddress(res, req);
+                    Admission admission = server.checkAdmission(address);
+                    if (admission != Admission::Accepted) {
+                        std::cout << "Rejecting client " << address << ": " << describeAdmission(admission) << std::endl;
+                        res->writeStatus("503 Service Unavailable")
+                            ->writeHeader("Retry-After", std::to_string(ADMISSION_RETRY_AFTER))
+                            ->end("Server is full, try again later.");
                         return;
                     }
 
-                    // get the time to print when the client connected
-                    auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-                    std::cout << std::ctime(&time) << "New client connected, addr: " << ws->getRemoteAddressAsText() << std::endl;
-
-                    clients.push_back(ws);
-
-                    // std::string wake = "[WAKE]";
-                    // ws->send(wake, uWS::TEXT);
-
-                    // Send a wake with all neeced information like, canvas size, timeout time, payload size, etc
-                    std::string wake = "[WAKE:cw:" + std::to_string(CANVAS_WIDTH) + ":ch:" + std::to_string(CANVAS_HEIGHT) +
-                        ":t:" + std::to_string(PIXEL_PLACE_TIMEOUT) + ":ps:" + std::to_string(MAX_PAYLOAD_SIZE) + "]";
-                    ws->send(wake, uWS::TEXT);
+                    MyUserData user_data;
+                    user_data.connection.address = std::move(address);
+                    res->template upgrade<MyUserData>(std::move(user_data),
+                        req->getHeader("sec-websocket-key"),
+                        req->getHeader("sec-websocket-protocol"),
+                        req->getHeader("sec-websocket-extensions"),
+                        context);
                 },
-                .message = [](WebSocketType* ws, std::string_view message, uWS::OpCode opCode) {
-                    // when message is long don't process it
-                    if (message.size() > 50) {
-                        std::cout << "Received long message, ignoring" << std::endl;
-                        return;
-                    }
-
-                    // if (message.starts_with("[MAP/RESEND:")) {
-                    // }
-
-                    // if message contains "STOP]", close the connection, FlipperHTTP sends [SOCKET/STOP] when closing
-                    if (message.find("STOP]") != std::string::npos) {
-                        std::cout << "Received STOP command: " << message << ", closing connection" << std::endl;
-                        ws->close();
-                        return;
-                    }
-
-                    if (message.find("[MAP/SYNC]") != std::string::npos) {
-                        std::cout << "Client requested canvas sync" << std::endl;
-                        sendCanvasInChunks(ws);
-                        return;
-                    }
-
-                    if (message.starts_with("[NAME]")) {
-                        // Set flipper name
-                        std::string new_name(message.substr(6)); // after "[NAME]"
-
-                        new_name.erase(std::remove_if(new_name.begin(), new_name.end(), ::isspace), new_name.end());
-                        if (new_name.size() > 10) {
-                            new_name = new_name.substr(0, 10);
-                        }
-                        if (new_name.empty()) {
-                            std::cout << "Invalid name received, ignoring" << std::endl;
-                            return;
-                        }
-
-                        ws->getUserData()->flipper_name = new_name;
-                        std::cout << "Client set name to: " << new_name << std::endl;
-
-                        sendCanvasInChunks(ws); // Send initial canvas state
-                        return;
-                    }
-
-                    if (message.starts_with("[PIXEL]")) {
-                        // check if pixel update is under timeout
-                        auto now = std::chrono::steady_clock::now();
-                        auto last_update = ws->getUserData()->last_pixel_update;
-                        if (now - last_update < std::chrono::milliseconds(PIXEL_PLACE_TIMEOUT)) {
-                            return;
-                        }
-                        ws->getUserData()->last_pixel_update = now;
-
-                        std::string_view pixel_data = message.substr(7); // get value after "[PIXEL]"
-                    
-                        auto x_pos = pixel_data.find("x:");
-                        auto y_pos = pixel_data.find(",y:");
-                        auto c_pos = pixel_data.find(",c:");
-                    
-                        if (x_pos != 0 || y_pos == std::string_view::npos || c_pos == std::string_view::npos) {
-                            std::cout << "Invalid pixel update format: " << message << std::endl;
-                            return;
-                        }
-                    
-                        auto x = std::stoul(std::string(pixel_data.substr(2, y_pos - 2)));
-                        auto y = std::stoul(std::string(pixel_data.substr(y_pos + 3, c_pos - (y_pos + 3))));
-                        auto color = std::stoul(std::string(pixel_data.substr(c_pos + 3)));
-                    
-                        if (x >= CANVAS_WIDTH || y >= CANVAS_HEIGHT) {
-                            std::cout << "Invalid pixel coordinates: (" << x << ", " << y << ")" << std::endl;
-                            return;
-                        }
-                        if (color > 1) {
-                            std::cout << "Invalid color value: " << color << std::endl;
-                            return;
-                        }
-                    
-                        setPixel(x, y, color == 1);
-
-                        // get name of the client
-                        std::string client_name = ws->getUserData()->flipper_name;
-                        if (client_name.empty()) {
-                            client_name = "Unknown";
-                            // send who are you message?
-                            // std::string who_are_you = "[WHOAREYOU]";
-                            // ws->send(who_are_you, uWS::TEXT);
-                        }
-                    
-                        std::cout << client_name << ": Set pixel (" << x << "," << y << ") to "
-                                  << (color ? "black" : "white") << std::endl;
-                    
-                        // send the updated pixel to all connected clients
-                        for (auto client : clients) {
-                            client->send(message, opCode);
-                        }
-                        return;
-                    }
-
-                    std::cout << "Received message: " << message << std::endl;
+                .open = [](WebSocketType* ws) {
+                    UwsConnection* connection = &ws->getUserData()->connection;
+                    connection->ws = ws;
+                    server.onOpen(connection);
+                },
+                .message = [](WebSocketType* ws, std::string_view message, uWS::OpCode /*opCode*/) {
+                    server.onMessage(&ws->getUserData()->connection, message);
                 },
                 .close = [](WebSocketType* ws, int /*code*/, std::string_view /*message*/) {
-                    // get the time to print when the client disconnected
-                    auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-                    std::cout << std::ctime(&time) << " Client disconnected" << std::endl;
-                    clients.erase(std::remove(clients.begin(), clients.end(), ws), clients.end());
+                    server.onClose(&ws->getUserData()->connection);
                 }
             })
         .any("/*", [](auto *res, auto *req) {
             std::string addr = std::string(res->getRemoteAddressAsText());
-            std::cout << "📡 Received an HTTP " << req->getMethod() << " request from " << addr 
+            std::cout << "📡 Received an HTTP " << req->getMethod() << " request from " << addr
               << " for URL: " << req->getMethod() << " " << req->getUrl() << std::endl;
-            res->writeStatus("404 Not Found")->end("This server expects WebSocket connections.");
+
+            // req is only valid in this call, keep what the API needs until the body is in
+            struct PendingRequest {
+                std::string method, url, query, authorization, if_none_match, range, body;
+                bool aborted = false;
+            };
+            auto pending = std::make_shared<PendingRequest>();
+            pending->method = req->getMethod();
+            pending->url = req->getUrl();
+            pending->query = req->getQuery();
+            pending->authorization = req->getHeader("authorization");
+            pending->if_none_match = req->getHeader("if-none-match");
+            pending->range = req->getHeader("range");
+
+            res->onAborted([pending]() { pending->aborted = true; });
+            res->onData([res, pending](std::string_view chunk, bool last) {
+                if (pending->aborted) {
+                    return;
+                }
+                if (pending->body.size() + chunk.size() > MAX_HTTP_BODY_SIZE) {
+                    pending->aborted = true;
+                    res->writeStatus("413 Payload Too Large")->end("Request body too large.", true);
+                    return;
+                }
+                pending->body.append(chunk);
+                if (!last) {
+                    return;
+                }
+
+                std::optional<ApiResponse> response = http_api.handle(
+                    {pending->method, pending->url, pending->query, pending->authorization, pending->if_none_match,
+                     pending->range, pending->body});
+                if (!response) {
+                    res->writeStatus("404 Not Found")->end("This server expects WebSocket connections.");
+                    return;
+                }
+                res->writeStatus(response->status);
+                if (!response->content_type.empty()) {
+                    res->writeHeader("Content-Type", response->content_type);
+                }
+                for (const auto& [name, value] : response->headers) {
+                    res->writeHeader(name, value);
+                }
+                res->end(response->payload());
+            });
         })
         .listen(
             WEBSOCKET_PORT,
@@ -320,23 +240,40 @@ int main() {
                 } else {
                     std::cerr << "Failed to listen on port " << WEBSOCKET_PORT << std::endl;
                 }
-            })
-        .run();
+            });
+
+    // Sample the server load on the event loop to adapt the pixel cooldown
+    struct us_timer_t* load_timer = us_create_timer((struct us_loop_t*)uWS::Loop::get(), 0, 0);
+    us_timer_set(load_timer, [](struct us_timer_t*) {
+        server.tick();
+        // append what changed since the last tick to the timelapse
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        timelapse.capture(canvas, uint32_t(std::chrono::duration_cast<std::chrono::seconds>(now).count()));
+    }, LOAD_SAMPLE_INTERVAL, LOAD_SAMPLE_INTERVAL);
+
+    // Batch canvas changes into one frame per interval, published once for all spectators
+    struct us_timer_t* spectator_timer = us_create_timer((struct us_loop_t*)uWS::Loop::get(), 0, sizeof(uWS::App*));
+    *(uWS::App**)us_timer_ext(spectator_timer) = &app;
+    us_timer_set(spectator_timer, [](struct us_timer_t* timer) {
+        uWS::App* app = *(uWS::App**)us_timer_ext(timer);
+        static std::string frame;
+        if (app->numSubscribers(SPECTATOR_TOPIC) > 0 && spectator_feed.collect(canvas, frame)) {
+            app->publish(SPECTATOR_TOPIC, frame, uWS::BINARY, true);
+        }
+    }, SPECTATOR_UPDATE_INTERVAL, SPECTATOR_UPDATE_INTERVAL);
 
-    clients.clear();
+    app.run();
 
     // save once before exiting
-    saveCanvasToFile(current_map_file);
+    canvas.saveToFile(current_map_file);
+    timelapse.close();
 
     keep_saving = false;
     if (save_thread.joinable()) {
         save_thread.join();
     }
 
-    free(painted_bytes);
-    painted_bytes = nullptr;
-    
     std::cout << "Server stopped." << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
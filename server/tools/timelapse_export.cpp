@@ -0,0 +1,54 @@
+// Streams a recorded timelapse as binary PBM frames, e.g.
+//   timelapse_export maps/timelapse 60 | ffmpeg -f image2pipe -c:v pbm -framerate 30 -i - timelapse.mp4
+// Only one keyframe and segment are held in memory, however long the history is.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../core/timelapse.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <timelapse directory> [step seconds] [from] [to]" << std::endl;
+        return 1;
+    }
+
+    TimelapseReader reader(argv[1]);
+    if (!reader.open() || reader.entries().empty()) {
+        std::cerr << "No timelapse found in " << argv[1] << std::endl;
+        return 1;
+    }
+
+    uint32_t step = argc > 2 ? uint32_t(std::strtoul(argv[2], nullptr, 10)) : 60;
+    uint32_t from = argc > 3 ? uint32_t(std::strtoul(argv[3], nullptr, 10)) : reader.firstTime();
+    uint32_t to = argc > 4 ? uint32_t(std::strtoul(argv[4], nullptr, 10)) : reader.lastTime();
+
+    // PBM rows are padded to whole bytes, most significant bit first, 1 is black like a painted pixel
+    const size_t row_bytes = (CANVAS_WIDTH + 7) / 8;
+    const std::string header = "P4\n" + std::to_string(CANVAS_WIDTH) + " " + std::to_string(CANVAS_HEIGHT) + "\n";
+    std::vector<uint8_t> frame(row_bytes * CANVAS_HEIGHT);
+    size_t frames = 0;
+
+    bool ok = reader.forEachFrame(from, to, step, [&](uint32_t /*time*/, const uint8_t* bytes) {
+        std::fill(frame.begin(), frame.end(), 0);
+        for (int y = 0; y < CANVAS_HEIGHT; ++y) {
+            for (int x = 0; x < CANVAS_WIDTH; ++x) {
+                size_t bit = size_t(y) * CANVAS_WIDTH + x;
+                if (bytes[bit / 8] & (1 << (bit % 8))) {
+                    frame[y * row_bytes + x / 8] |= uint8_t(0x80 >> (x % 8));
+                }
+            }
+        }
+        std::fwrite(header.data(), 1, header.size(), stdout);
+        std::fwrite(frame.data(), 1, frame.size(), stdout);
+        frames++;
+        return !std::ferror(stdout);
+    });
+
+    std::cerr << "Exported " << frames << " frames from " << from << " to " << to << std::endl;
+    return ok ? 0 : 1;
+}